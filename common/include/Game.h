@@ -1,7 +1,15 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
 #include "Input.h"
 #include "Metrics.h"
+#include "Player.h"
 #include "World.h"
+#include "merkle_tree.h"
+#include "state_reader.h"
+#include "state_writer.h"
 
 class Rollback;
 
@@ -16,75 +24,87 @@ enum class BallType {
 
 enum class GameState { kMenu, kInGame, kGameFinished };
 
+// A set of bodies by the bit of their index, only the first 64 bodies can be
+// in a set, see World::UpdateIsland.
+using BodyMask = std::uint64_t;
+
 /**
- * \brief Handles the physics state of the app
+ * \brief The gameplay state of a game, everything that changes during a
+ * match except the physics world.
+ *
+ * It is trivially copyable, so a snapshot copies it whole in one memcpy and
+ * a new field cannot be forgotten by the copy.
  */
-class Game : public ContactListener {
- private:
-  World world_;
-
-  GameState state_ = GameState::kMenu;
-
-  input::Input input_{};
-  input::Input other_player_input_{};
-
-  std::vector<BodyRef> body_refs_;
-  std::vector<ColliderRef> col_refs_;
-
-  ColliderRef ground_col_ref_{};
-
-  // Represents a reference to the blue player's body in the physics engine.
-  BodyRef player_blue_body_ref_{};
+struct GameplayState {
+  GameState state = GameState::kMenu;
 
-  // Represents a reference to the blue player's main collision shape.
-  ColliderRef player_blue_col_ref_{};
+  // The number of players in the game, between metrics::kMinPlayerNbr and
+  // metrics::kMaxPlayerNbr.
+  int player_count = metrics::kMinPlayerNbr;
 
-  // Represents a reference to the blue player's feet collision shape,
-  // used for kicking the ball.
-  ColliderRef player_blue_feet_col_ref_{};
+  // The state of every player, only the first player_count are used.
+  std::array<Player, metrics::kMaxPlayerNbr> players{};
 
-  // Indicates whether the blue player is currently on the ground.
-  bool is_player_blue_grounded_ = false;
+  // Keeps track of the score of each team; initially set to zero.
+  std::array<int, static_cast<int>(Team::kCount)> team_scores{};
 
-  // A timer tracking the time elapsed since the blue player last kicked the
-  // ball, initially set to 1 second so the player can kick from the start.
-  float player_blue_kick_time_ = 1.f;
+  // represents the type of the ball, it changes it's bouciness and mass so the
+  // game is less repetitive, not fully implemented yet
+  BallType ball_type = BallType::kFootball;
 
-  // A flag indicating whether the blue player can currently kick the ball
-  bool can_player_blue_kick_ = false;
+  // Represents a reference to the ball's body in the physics engine.
+  BodyRef ball_body_ref{};
 
-  // Keeps track of the blue player's score in the game; initially set to zero.
-  int blue_score_ = 0;
+  // Represents a reference to the ball's main collision shape.
+  ColliderRef ball_col_ref{};
 
-  ColliderRef player_red_col_ref_{};
+  // Represents the radius of ball, it changes depending on the BallType,
+  //  not fully implemented yet
+  float ball_radius = metrics::kBallRadiusMedium;
 
-  ColliderRef player_red_feet_col_ref_{};
+  ColliderRef ground_col_ref{};
+  ColliderRef left_goal_col_ref{};
+  ColliderRef right_goal_col_ref{};
 
-  float player_red_kick_time_ = 1.f;
+  static constexpr int kMaxInteractionGroupNbr = 8;
 
-  bool can_player_red_kick_ = false;
+  // The groups of dynamic bodies that touched each other, directly or through
+  // other bodies, during the last frame. They are not part of the checksum,
+  // the rollback uses them to know what a changed input can affect.
+  std::array<BodyMask, kMaxInteractionGroupNbr> interaction_groups{};
+  int interaction_group_count = 0;
 
-  // represents the type of the ball, it changes it's bouciness and mass so the
-  // game is less repetitive, not fully implemented yet
-  BallType ball_type_ = BallType::kFootball;
+  // Set when every body was affected during the last frame, by a goal or
+  // because there were too many groups to track them.
+  bool has_global_interaction = false;
+};
 
-  // Represents a reference to the ball's body in the physics engine.
-  BodyRef ball_body_ref_{};
+static_assert(std::is_trivially_copyable_v<GameplayState>,
+              "The gameplay state must be copied with a memcpy.");
 
-  // Represents a reference to the ball's main collision shape.
-  ColliderRef ball_col_ref_{};
+/**
+ * \brief Handles the physics state of the app
+ */
+class Game : public ContactListener {
+ private:
+  World world_;
 
-  // Represents the radius of ball, it changes depending on the BallType,
-  //  not fully implemented yet
-  float ball_radius_ = metrics::kBallRadiusMedium;
+  GameplayState gameplay_{};
 
-  int red_score_ = 0;
+  // Indicates whether the game is resimulated by the rollback, only its final
+  // state is observed so everything that is not needed to compute it is
+  // skipped.
+  bool is_resimulating_ = false;
 
-  ColliderRef left_goal_col_ref_{};
-  ColliderRef right_goal_col_ref_{};
-  BodyRef player_red_body_ref_{};
+  // The checksum hashes the static bodies and colliders only when the
+  // structure of the world changed, and hashes the rest on every call.
+  bool is_checksum_incremental_ = true;
+  bool has_static_checksum_ = false;
+  std::uint32_t static_checksum_version_ = 0;
+  std::uint32_t static_checksum_ = 0;
 
-  bool is_player_red_grounded_ = false;
+  // Keeps its memory between two checksums.
+  StateWriter state_writer_{};
 
   static constexpr float kBallGravity = 1000;
   static constexpr float kPlayerGravity = 2500;
@@ -95,6 +115,9 @@ class Game : public ContactListener {
 
   static constexpr float kShootForce = 25000;
 
+  // Horizontal distance between two players of the same team at kick-off.
+  static constexpr float kPlayerSpacing = metrics::kPlayerRadius * 2.5f;
+
  public:
   int player_nbr = -1;
 
@@ -113,16 +136,62 @@ class Game : public ContactListener {
   Math::Vec2F GetBallVelocity() noexcept;
   BallType GetBallType() noexcept;
 
-  int GetBlueScore() noexcept { return blue_score_; }
-  int GetRedScore() noexcept { return red_score_; }
+  int GetTeamScore(Team team) const noexcept {
+    return gameplay_.team_scores[static_cast<int>(team)];
+  }
 
-  Math::Vec2F GetPlayerBluePos() noexcept;
-  Math::Vec2F GetPlayerRedPos() noexcept;
+  int GetPlayerCount() const noexcept { return gameplay_.player_count; }
 
-  void SetPlayerInput(input::Input input) noexcept;
-  void SetOtherPlayerInput(input::Input input) noexcept;
+  Math::Vec2F GetPlayerPos(int player_id) noexcept;
 
-  void SetBallType(BallType type) noexcept { ball_type_ = type; }
+  void SetPlayerInput(int player_id, input::Input input) noexcept;
+
+  input::Input GetPlayerInput(int player_id) const noexcept {
+    return gameplay_.players[player_id].input;
+  }
+
+  BodyMask GetPlayerBodyMask(int player_id) const noexcept;
+
+  // The ball and the players.
+  BodyMask GetDynamicBodyMask() const noexcept;
+
+  /**
+   * @brief Adds to a set of bodies the ones that touched them during the last
+   * frame, or every body if the whole world was affected.
+   */
+  BodyMask AddInteractingBodies(BodyMask bodies) const noexcept;
+
+  /**
+   * @brief Simulates a frame for the bodies of an island only, the players
+   * whose body is outside of it are skipped too. The rest of the game must
+   * then be copied from a state where it was simulated, see
+   * CopyOutsideIsland.
+   * @param outside The state after this frame the rest is copied from.
+   * @return false if the island touched a body outside of it or a goal was
+   * scored, the frame must then be simulated whole from the previous state.
+   */
+  bool FixedUpdateIsland(BodyMask island, const Game& outside) noexcept;
+
+  /**
+   * @brief Copies everything that is outside of an island from another state
+   * of the same match: the bodies, the players and the interactions.
+   */
+  void CopyOutsideIsland(const Game& other, BodyMask island) noexcept;
+
+  void SetBallType(BallType type) noexcept { gameplay_.ball_type = type; }
+
+  // Must be called before StartGame.
+  void SetPlayerCount(int player_count) noexcept {
+    gameplay_.player_count = player_count;
+  }
+
+  // Side effects that are not part of the game state (audio, visual effects,
+  // profiling texts) must not be triggered while resimulating.
+  void SetResimulating(bool is_resimulating) noexcept {
+    is_resimulating_ = is_resimulating;
+    world_.SetLightweight(is_resimulating);
+  }
+  bool IsResimulating() const noexcept { return is_resimulating_; }
 
   void EndGame();
   void Restart();
@@ -135,11 +204,63 @@ class Game : public ContactListener {
 
   void OnCollisionExit(ColliderRef col1, ColliderRef col2) noexcept override {}
 
+  /**
+   * @brief Computes the CRC32C of the canonical serialization of the whole
+   * game state: every body and collider of the world, the overlapping
+   * colliders, the players and the scores.
+   */
   int CheckSum() noexcept;
 
+  /**
+   * @brief Writes the whole game state: the body count then the generation
+   * index and the body of each index, the collider count then the generation
+   * index and the collider of each index, the overlapping colliders, the
+   * player count then each player, and the score of each team.
+   */
+  void Serialize(StateWriter& writer) const;
+
+  /**
+   * @brief Reads back a state written by Serialize on a started game with the
+   * same player count.
+   * @return false if the data is not a valid state, the game is unchanged.
+   */
+  bool Deserialize(StateReader& reader);
+
+  /**
+   * @brief Hashes every body, every collider, the overlapping colliders, each
+   * player and the scores in their own leaf of a merkle tree.
+   */
+  void ComputeEntityHashes(MerkleTree& tree);
+
+  // The checksum is the same in both modes, the incremental mode only skips
+  // hashing the static bodies and colliders again.
+  void SetIncrementalChecksum(bool is_incremental) noexcept {
+    is_checksum_incremental_ = is_incremental;
+  }
+
  private:
   void ProcessInput() noexcept;
+  void ProcessPlayerInput(int player_id) noexcept;
   void ResetPositions() noexcept;
+  void ApplyPlayerPhysics(const Player& player) noexcept;
+
+  void ClearInteractions() noexcept;
+  // Merges the groups of two bodies, only the dynamic bodies are tracked.
+  void AddInteraction(const BodyRef& body_ref_a,
+                      const BodyRef& body_ref_b) noexcept;
+  // The overlapping triggers let the players kick the ball.
+  void AddTriggerInteractions() noexcept;
+
+  [[nodiscard]] bool IsStaticCollider(const Collider& collider) const noexcept;
+  // The static region is made of the static bodies and of the colliders
+  // attached to them, it only changes with the structure of the world.
+  void SerializeStaticRegion(StateWriter& writer) const;
+  void SerializeDynamicRegion(StateWriter& writer) const;
+  void SerializeContacts(StateWriter& writer) const;
+  void SerializePlayer(StateWriter& writer, int player_id) const;
+  void SerializeScores(StateWriter& writer) const;
+
+  [[nodiscard]] static Math::Vec2F GetSpawnPosition(int player_id) noexcept;
 
   void CreateBall() noexcept;
   void CreateTerrain() noexcept;
@@ -47,6 +47,14 @@ constexpr Input kRight = 1 << 2;
  */
 constexpr Input kKick = 1 << 3;
 
+/**
+ * @brief Number of bits used by the input actions.
+ *
+ * An Input can only take 1 << kBitCount different values, every bit above is
+ * always zero.
+ */
+constexpr int kBitCount = 4;
+
 /**
  * @struct FrameInput
  * @brief Represents the input data for a single frame.
@@ -63,8 +71,8 @@ constexpr Input kKick = 1 << 3;
  * frame in the game. Default value is 0.
  */
 struct FrameInput {
-  Input input = 0;      ///< The input actions for the frame.
-  short frame_nbr = 0;  ///< The frame number for the input data.
+  Input input = 0;    ///< The input actions for the frame.
+  int frame_nbr = 0;  ///< The frame number for the input data.
 };
 
 }  // namespace input
\ No newline at end of file
@@ -28,8 +28,26 @@ constexpr Math::Vec2F kGroundSize{kWindowWidth / 7.f, kWindowHeight / 5.f};
 constexpr Math::Vec2F kGoalSize = {MetersToPixels(0.6f), kWindowHeight / 3.f};
 constexpr float kPlayerRadius = MetersToPixels(0.5f);
 
+constexpr int kMinPlayerNbr = 2;
+constexpr int kMaxPlayerNbr = 8;
+
 constexpr float kFixedDeltaTime = 1.f / kFPS;
 
-constexpr int kGameFrameNbr = 5400; // 1:30 min at 60 hertz
+constexpr int kGameDuration = 90;  // seconds
+
+constexpr int kGameFrameNbr = kGameDuration * kFPS;
+
+// Maximum number of frames between the last confirmed frame and the current
+// frame. The rollback keeps its inputs in ring buffers of this size so it
+// must be a power of two.
+constexpr int kMaxRollbackFrames = 64;
+
+// Maximum number of frames the rollbacks simulate again during one rendered
+// frame, the rest is caught up during the next ones.
+constexpr int kResimulationBudget = 16;
+
+// Maximum number of unacknowledged inputs sent again in each input packet,
+// the older ones are sent once over the reliable channel.
+constexpr int kInputRedundancy = 16;
 
 }  // namespace metrics
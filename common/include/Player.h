@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Input.h"
+#include "Refs.h"
+
+/**
+ * \brief The teams of the game, the players with an even number are in the
+ * blue team and the others in the red team.
+ */
+enum class Team { kBlue = 0, kRed, kCount };
+
+[[nodiscard]] constexpr Team GetPlayerTeam(const int player_id) noexcept {
+  return static_cast<Team>(player_id % static_cast<int>(Team::kCount));
+}
+
+/**
+ * \brief Physics and gameplay state of one player.
+ */
+struct Player {
+  // Represents a reference to the player's body in the physics engine.
+  BodyRef body_ref{};
+
+  // Represents a reference to the player's main collision shape.
+  ColliderRef col_ref{};
+
+  // Represents a reference to the player's feet collision shape, used for
+  // kicking the ball.
+  ColliderRef feet_col_ref{};
+
+  // The input applied to the player during the next fixed update.
+  input::Input input = 0;
+
+  // Indicates whether the player is currently on the ground.
+  bool is_grounded = false;
+
+  // A timer tracking the time elapsed since the player last kicked the ball,
+  // initially set to 1 second so the player can kick from the start.
+  float kick_time = 1.f;
+
+  // A flag indicating whether the player can currently kick the ball.
+  bool can_kick = false;
+};
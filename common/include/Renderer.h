@@ -28,6 +28,11 @@ class Renderer {
       metrics::kWindowWidth * 0.333f, metrics::kWindowHeight * 0.1f};
   raylib::Color start_btn_text_color_ = raylib::WHITE;
 
+  raylib::Rectangle spectate_btn_rect = {
+      metrics::kWindowWidth * 0.333f, metrics::kWindowHeight * 0.35f,
+      metrics::kWindowWidth * 0.333f, metrics::kWindowHeight * 0.1f};
+  raylib::Color spectate_btn_text_color_ = raylib::WHITE;
+
   Image2D ball_{};
   Image2D ground_{};
   Image2D goal_left_{};
@@ -52,6 +57,9 @@ class Renderer {
 
   void SetGameTime(float time);
 
+  // Shows the menu buttons again when joining a room failed.
+  void CancelWaiting() noexcept { isWaitingOtherPlayer = false; }
+
  private:
   void SetupBall();
   void SetupPlayers();
@@ -2,13 +2,24 @@
 
 #include "Audio.h"
 #include "Renderer.h"
+#include "desync_dump.h"
+#include "input_delay.h"
 #include "network.h"
+#include "packet.h"
+#include "replay.h"
 #include "rollback.h"
+#include "spectator.h"
+#include "state_transfer.h"
+#include "time_sync.h"
 
 #ifdef PLATFORM_WEB
 #include <emscripten/emscripten.h>
 #else
 #endif
+#include <array>
+#include <chrono>
+#include <deque>
+#include <map>
 #include <queue>
 
 class Application {
@@ -19,7 +30,24 @@ class Application {
   void Run();
   void TearDown();
 
+  /**
+   * @brief Starts playing the started game from the confirmed frames instead
+   * of the inputs, called when joining a room as a spectator.
+   */
+  void StartSpectating() noexcept;
+
+  /**
+   * @brief Asks the master client for its confirmed state and stops the
+   * simulation until it is loaded, called after a desync or when rejoining
+   * the game. The master client has the right state already.
+   */
+  void RequestState() noexcept;
+
  private:
+  // A state request is sent again when no part of the state arrived for
+  // this long, the master client may have given up its transfer.
+  static constexpr std::chrono::seconds kStateRequestTimeout{2};
+
   Rollback rollback_{};
   Game game_{};
 
@@ -30,11 +58,137 @@ class Application {
   Timer game_timer_{};
   float game_time_ = 0;
 
-  std::vector<input::Input> inputs_{};
-  std::vector<short> frames_{};
+  // How many frames ahead the local inputs are scheduled.
+  InputDelay input_delay_{};
+
+  Spectator spectator_{};
+
+  // Slows the fixed step down while we run ahead of the other players.
+  TimeSync time_sync_{};
+
+  // Our inputs that are not confirmed yet, one for each frame in order.
+  std::deque<input::FrameInput> local_inputs_{};
+  // The last of our frames a player received all the inputs up to, from its
+  // newest input packet. A player who loaded a state forgot the inputs after
+  // it, the packets sent since acknowledge from there.
+  struct InputAck {
+    int loaded_state_count = 0;
+    int remote_frame = -1;
+    int acked_frame = -1;
+  };
+  std::array<InputAck, metrics::kMaxPlayerNbr> input_acks_{};
+  // The last of our frames sent over the reliable channel.
+  int reliable_input_frame_ = -1;
+  // The number of states we loaded from the master client, sent with our
+  // inputs.
+  int loaded_state_count_ = 0;
+
+  // The checksums received from the master client for the frames we
+  // confirmed, waiting for our own checksums.
+  std::queue<ConfirmedFrame> remote_confirmations_{};
+
+  // The first frame whose checksum differs from the master client, while the
+  // entity that diverged is searched in its merkle tree.
+  int desync_frame_ = -1;
+  // The last frame written to a desync dump.
+  int dumped_frame_ = -1;
+
+  // Every confirmed frame of the game, written to the desync dumps and to the
+  // replay.
+  std::vector<ConfirmedFrame> confirmed_frames_{};
+
+  // The master client sends its confirmed state to the players who lost
+  // theirs, one transfer for each player.
+  std::array<StateTransferSender, metrics::kMaxPlayerNbr> state_senders_{};
+  int last_transfer_id_ = -1;
+
+  // Puts together the state received from the master client, the frames it
+  // confirms meanwhile are replayed on top of it once it is loaded.
+  StateTransferReceiver state_receiver_{};
+  std::vector<ConfirmedFrame> pending_confirmations_{};
+  // The inputs of each player received meanwhile, by frame.
+  std::array<std::map<int, input::Input>, metrics::kMaxPlayerNbr>
+      pending_inputs_{};
+  bool is_waiting_for_state_ = false;
+  std::chrono::steady_clock::time_point last_state_time_{};
+
+  // The packets are written and received in the same buffers every frame.
+  StateWriter packet_writer_{};
+  TransportPacket received_packet_{};
 
  private:
   void HandlePacket();
-  void SendFrameConfirmation(
-      const std::vector<input::FrameInput>& remote_frame_inputs) noexcept;
+  void HandleSpectatorPackets();
+  void ConfirmFrames() noexcept;
+  void HandleConfirmedFrames() noexcept;
+
+  void SendMerkleRequest(int frame_nbr, const std::vector<int>& nodes) noexcept;
+  void SendMerkleReply(const Packet& request) noexcept;
+  void HandleMerkleReply(const Packet& reply) noexcept;
+
+  void DumpDesync(int frame_nbr) noexcept;
+
+  void SendStateRequest() noexcept;
+  void SendStateChunks() noexcept;
+  void HandleStateRequest(const Packet& request) noexcept;
+  void HandleStateChunk(const Packet& packet) noexcept;
+
+  /**
+   * @brief Loads the state received from the master client, then replays the
+   * frames it confirmed since and schedules again our inputs after them.
+   */
+  void RestoreState() noexcept;
+
+  /**
+   * @brief Simulates and confirms the frame after the loaded state with the
+   * inputs confirmed by the master client.
+   * @return false if it is not the frame to confirm.
+   */
+  bool ReplayConfirmation(const ConfirmedFrame& confirmed_frame) noexcept;
+
+  /**
+   * @brief Keeps for the replay a frame confirmed by the master client up to
+   * the loaded state, which our confirmation worker did not simulate. It is
+   * dropped if it does not follow the last kept frame.
+   */
+  void AddRestoredConfirmation(const ConfirmedFrame& confirmed_frame) noexcept;
+
+  /**
+   * @brief Writes the confirmed frames of the match that just finished to a
+   * replay file.
+   */
+  void SaveReplay() noexcept;
+
+  /**
+   * @return A confirmation of frame -1 if the packet is not valid.
+   */
+  [[nodiscard]] ConfirmedFrame ReadConfirmedFrame(
+      const Packet& packet) const noexcept;
+
+  /**
+   * @brief Decodes the packets received by the transport of the network and
+   * queues them.
+   */
+  void ReceivePackets();
+
+  /**
+   * @brief Starts writing a packet of the given type, the payload is written
+   * after it and the packet is sent with SendPacket.
+   */
+  StateWriter& StartPacket(PacketType type) noexcept;
+  void SendPacket(bool reliable,
+                  int player_nbr = Transport::kAllPeers) noexcept;
+
+  void EraseConfirmedInputs(int confirmed_frame) noexcept;
+
+  /**
+   * @brief Sends our last inputs that are not acknowledged by every player,
+   * at most metrics::kInputRedundancy of them. The ones before are sent once
+   * over the reliable channel, and once more when a player who loaded a state
+   * forgot them.
+   */
+  void SendInputs() noexcept;
+  void WriteInputPacket(std::deque<input::FrameInput>::const_iterator begin,
+                        std::deque<input::FrameInput>::const_iterator end);
+
 };
\ No newline at end of file
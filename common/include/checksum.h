@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace checksum {
+
+/**
+ * @brief Computes the CRC32C (Castagnoli) of a buffer. Uses the SSE4.2 crc32
+ * instruction when the cpu supports it, a lookup table otherwise, both give
+ * the same result.
+ * @param data The bytes to hash.
+ * @param size The number of bytes to hash.
+ * @param crc The crc of the bytes that come before, so a buffer can be hashed
+ * in several parts: Crc32c(b, Crc32c(a)) is the crc of a followed by b.
+ * @return The crc of all the bytes.
+ */
+[[nodiscard]] std::uint32_t Crc32c(const void* data, std::size_t size,
+                                   std::uint32_t crc = 0) noexcept;
+
+}  // namespace checksum
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Game.h"
+#include "Input.h"
+#include "Metrics.h"
+#include "merkle_tree.h"
+#include "ring_buffer.h"
+#include "spsc_queue.h"
+#include "state_writer.h"
+
+/**
+ * @brief The inputs of every player at a confirmed frame, and the checksum and
+ * the merkle root of the confirmed state once the frame is simulated.
+ */
+struct ConfirmedFrame {
+  int frame_nbr = -1;
+  std::array<input::Input, metrics::kMaxPlayerNbr> inputs{};
+  int checksum = 0;
+  std::uint32_t merkle_root = 0;
+};
+
+/**
+ * @brief Simulates the confirmed timeline on its own thread and publishes the
+ * checksum of every confirmed frame, so a burst of confirmations never stalls
+ * the fixed update loop.
+ */
+class ConfirmationWorker {
+ public:
+  // Confirmed frames waiting to be simulated or to be read, about four
+  // seconds of game.
+  static constexpr int kQueueSize = 256;
+  // The merkle trees and the states of the last confirmed frames are kept to
+  // find where a desync comes from, about two seconds of game.
+  static constexpr int kMerkleHistorySize = 128;
+
+  ConfirmationWorker() = default;
+  ~ConfirmationWorker() { Stop(); }
+
+  ConfirmationWorker(const ConfirmationWorker&) = delete;
+  ConfirmationWorker& operator=(const ConfirmationWorker&) = delete;
+
+  /**
+   * @brief Starts a new confirmed timeline from the start of a game with the
+   * given player count and ball type. Stops the previous one if any.
+   */
+  void Start(int player_count, BallType ball_type);
+
+  /**
+   * @brief Starts a new confirmed timeline from a confirmed state received
+   * from another player, the next pushed frame is the one after it. Stops the
+   * previous one if any.
+   */
+  void Start(const Game& state);
+
+  /**
+   * @brief Stops the thread, the frames that are not simulated yet are lost.
+   */
+  void Stop() noexcept;
+
+  /**
+   * @brief Sends the inputs of the next confirmed frame to the worker. Waits
+   * if the worker is too far behind.
+   */
+  void PushFrame(const ConfirmedFrame& frame) noexcept;
+
+  /**
+   * @brief Gets the next simulated confirmed frame with its checksum.
+   * @return false if no new frame was simulated.
+   */
+  bool TryPopChecksum(ConfirmedFrame& frame) noexcept {
+    return checksums_.TryPop(frame);
+  }
+
+  /**
+   * @brief Copies the merkle tree of a recent simulated confirmed frame.
+   * @return false if the frame is not simulated yet or is too old.
+   */
+  bool CopyMerkleTree(int frame_nbr, MerkleTree& tree) const;
+
+  /**
+   * @brief Copies the serialized state of a recent simulated confirmed frame,
+   * the one its checksum was computed on, see Game::Serialize.
+   * @return false if the frame is not simulated yet or is too old.
+   */
+  bool CopyState(int frame_nbr, std::vector<std::uint8_t>& state) const;
+
+ private:
+  Game game_{};
+  int player_count_ = metrics::kMinPlayerNbr;
+
+  SpscQueue<ConfirmedFrame, kQueueSize> frames_{};
+  SpscQueue<ConfirmedFrame, kQueueSize> checksums_{};
+
+  // Only touched by the worker thread.
+  MerkleTree merkle_tree_{};
+  StateWriter state_writer_{};
+  std::vector<std::uint8_t> state_{};
+  // The checksums that do not fit in the queue, the main thread does not read
+  // them while it replays the confirmations received during a state
+  // transfer. The worker never waits for it, or both would wait on each
+  // other once the two queues are full.
+  std::deque<ConfirmedFrame> pending_checksums_{};
+
+  mutable std::mutex merkle_mutex_;
+  RingBuffer<MerkleTree, kMerkleHistorySize> merkle_trees_{};
+  RingBuffer<std::vector<std::uint8_t>, kMerkleHistorySize> states_{};
+  RingBuffer<int, kMerkleHistorySize> merkle_tree_frames_{};
+
+  std::thread thread_{};
+  std::atomic<bool> is_running_{false};
+
+  /**
+   * @brief Stops the thread and drops the frames of the previous timeline.
+   */
+  void Clear() noexcept;
+
+  /**
+   * @brief Moves the pending checksums to the queue read by the main thread,
+   * as many as it can hold.
+   */
+  void FlushChecksums() noexcept;
+
+  void Loop() noexcept;
+};
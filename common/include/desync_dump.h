@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Game.h"
+#include "confirmation_worker.h"
+
+/**
+ * @brief Everything a client knows about a frame whose checksum differs from
+ * the master client, saved to a compact binary file so the desync can be
+ * reproduced offline.
+ */
+struct DesyncDump {
+  static constexpr std::uint32_t kMagic = 0x53444252;  // "RBDS"
+  static constexpr std::uint32_t kVersion = 1;
+
+  int player_count = metrics::kMinPlayerNbr;
+  BallType ball_type = BallType::kFootball;
+  // The client that wrote the dump.
+  int player_nbr = -1;
+  // The first frame whose checksum differs.
+  int frame_nbr = -1;
+
+  // The game state after the frame, see Game::Serialize. Empty if the client
+  // did not keep the state of this frame anymore.
+  std::vector<std::uint8_t> state{};
+
+  // The inputs and the checksum of every confirmed frame from the start of
+  // the game to the desync frame, so the whole game can be simulated again.
+  std::vector<ConfirmedFrame> confirmed_frames{};
+
+  /**
+   * @brief Writes the dump to a file.
+   * @return false if the file cannot be written.
+   */
+  bool Save(const std::string& path) const;
+
+  /**
+   * @brief Reads a dump written by Save.
+   * @return false if the file cannot be read or is not a dump.
+   */
+  bool Load(const std::string& path);
+};
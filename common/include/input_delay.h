@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Metrics.h"
+
+/**
+ * @brief Chooses how many frames ahead the local inputs are scheduled from
+ * the measured round trip time and jitter.
+ *
+ * Every frame of latency hidden by the delay is a frame that does not need to
+ * be predicted and resimulated, the rollback only covers what is left. The
+ * delay only moves by one frame at a time once the measure has been stable
+ * for a while, so the player does not feel it change.
+ */
+class InputDelay {
+ public:
+  static constexpr int kDefaultMinDelay = 0;
+  static constexpr int kDefaultMaxDelay = 3;
+  // The number of frames the target delay must stay above or below the
+  // current delay before it changes, half a second.
+  static constexpr int kStableFrames = metrics::kFPS / 2;
+
+  /**
+   * @brief Sets the bounds of the delay, the current delay is clamped to
+   * them. The delay is fixed when both bounds are equal.
+   */
+  void SetBounds(int min_delay, int max_delay) noexcept;
+
+  /**
+   * @brief Updates the delay with a new measure, called once per frame.
+   * @param round_trip_time The round trip time to the server, in
+   * milliseconds.
+   * @param jitter The variance of the round trip time, in milliseconds.
+   */
+  void Update(int round_trip_time, int jitter) noexcept;
+
+  void Reset() noexcept;
+
+  /**
+   * @brief Gets the number of frames between the frame an input is sampled
+   * and the frame it is applied.
+   */
+  [[nodiscard]] int GetDelay() const noexcept { return delay_; }
+
+  /**
+   * @brief Gets the delay that would hide the measured latency, without the
+   * hysteresis.
+   */
+  [[nodiscard]] int GetTargetDelay() const noexcept { return target_delay_; }
+
+ private:
+  int min_delay_ = kDefaultMinDelay;
+  int max_delay_ = kDefaultMaxDelay;
+
+  int delay_ = kDefaultMinDelay;
+  int target_delay_ = kDefaultMinDelay;
+  // The number of consecutive frames the target was above (positive) or
+  // below (negative) the delay.
+  int stable_frames_ = 0;
+};
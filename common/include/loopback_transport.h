@@ -0,0 +1,85 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "transport.h"
+
+class LoopbackNetwork;
+
+/**
+ * @brief The end of a LoopbackNetwork used by one peer.
+ */
+class LoopbackTransport final : public Transport {
+ public:
+  LoopbackTransport(LoopbackNetwork* network, int peer) noexcept
+      : network_(network), peer_(peer) {}
+
+  void SendUnreliable(int peer, const std::uint8_t* data,
+                      std::size_t size) override;
+  void SendReliable(int peer, const std::uint8_t* data,
+                    std::size_t size) override;
+  bool Receive(TransportPacket& packet) override;
+
+  // The packets are delivered when they are sent.
+  void Service() override {}
+
+  [[nodiscard]] int GetPeer() const noexcept { return peer_; }
+
+ private:
+  friend class LoopbackNetwork;
+
+  LoopbackNetwork* network_ = nullptr;
+  int peer_ = -1;
+
+  std::deque<TransportPacket> received_{};
+};
+
+/**
+ * @brief Connects the peers of a session in the same process, to run several
+ * sessions headless in tests and benchmarks without a network.
+ *
+ * A sent packet is copied once in a buffer of the receiver, the buffers of the
+ * received packets are swapped with the ones given back by Receive so no
+ * allocation is done once the buffers are warm. The unreliable packets can be
+ * dropped at random to test the behavior under packet loss.
+ */
+class LoopbackNetwork {
+ public:
+  explicit LoopbackNetwork(int peer_count, unsigned int seed = 0);
+
+  LoopbackNetwork(const LoopbackNetwork&) = delete;
+  LoopbackNetwork& operator=(const LoopbackNetwork&) = delete;
+
+  [[nodiscard]] LoopbackTransport& GetTransport(int peer) noexcept {
+    return *transports_[peer];
+  }
+
+  [[nodiscard]] int GetPeerCount() const noexcept {
+    return static_cast<int>(transports_.size());
+  }
+
+  /**
+   * @brief Sets the probability for an unreliable packet to be lost, between
+   * 0 and 1.
+   */
+  void SetLossRate(float loss_rate) noexcept { loss_rate_ = loss_rate; }
+
+ private:
+  friend class LoopbackTransport;
+
+  std::vector<std::unique_ptr<LoopbackTransport>> transports_{};
+
+  // The buffers given back by Receive, reused for the next packets.
+  std::vector<std::vector<std::uint8_t>> free_buffers_{};
+
+  float loss_rate_ = 0.f;
+  std::mt19937 random_engine_;
+
+  void Send(int sender, int receiver, const std::uint8_t* data,
+            std::size_t size, bool is_reliable);
+  void Deliver(int sender, int receiver, const std::uint8_t* data,
+               std::size_t size);
+};
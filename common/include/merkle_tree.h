@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The part of the game state hashed by a leaf of a merkle tree.
+ */
+enum class EntityKind : std::uint8_t {
+  kBody = 0,
+  kCollider,
+  kContacts,
+  kPlayer,
+  kScores,
+  kPadding
+};
+
+/**
+ * @brief Hash tree of a game state with one leaf per entity, so two clients
+ * with different states can find which entity diverged by comparing a few
+ * nodes instead of the whole state.
+ *
+ * The tree is binary and stored as an array: the root is the node 1, the
+ * children of the node i are 2i and 2i + 1, and the leaves are the last
+ * GetLeafCount() nodes. The leaves are padded to a power of two.
+ */
+class MerkleTree {
+ public:
+  static constexpr int kRootNode = 1;
+
+  /**
+   * @brief Removes every leaf, keeps the memory for the next state.
+   */
+  void Clear() noexcept;
+
+  void AddLeaf(EntityKind kind, int entity_index, std::uint32_t hash);
+
+  /**
+   * @brief Pads the leaves and computes the inner nodes, must be called after
+   * the last leaf is added.
+   */
+  void Build();
+
+  [[nodiscard]] std::uint32_t GetRoot() const noexcept {
+    return nodes_[kRootNode];
+  }
+
+  [[nodiscard]] int GetNodeCount() const noexcept {
+    return static_cast<int>(nodes_.size());
+  }
+
+  [[nodiscard]] std::uint32_t GetNode(int node) const noexcept {
+    return nodes_[node];
+  }
+
+  [[nodiscard]] int GetLeafCount() const noexcept { return leaf_count_; }
+
+  [[nodiscard]] bool IsLeaf(int node) const noexcept {
+    return node >= leaf_count_;
+  }
+
+  /**
+   * @brief Gets the name of the entity hashed by a leaf node, like "body 3".
+   */
+  [[nodiscard]] std::string DescribeLeaf(int node) const;
+
+ private:
+  struct Leaf {
+    EntityKind kind = EntityKind::kPadding;
+    int entity_index = 0;
+  };
+
+  std::vector<Leaf> leaves_{};
+  std::vector<std::uint32_t> leaf_hashes_{};
+
+  // Only valid after Build, the node 0 is not used.
+  std::vector<std::uint32_t> nodes_ = std::vector<std::uint32_t>(2, 0);
+  int leaf_count_ = 1;
+};
@@ -4,13 +4,19 @@
 #include <LoadBalancing-cpp/inc/Client.h>
 
 #include "Renderer.h"
-#include "packet.h"
+#include "photon_transport.h"
 #include "rollback.h"
 
 class Application;
 
 class Network final : public ExitGames::LoadBalancing::Listener {
  public:
+  // The number of spectators that can join a room on top of the players.
+  static constexpr int kMaxSpectatorNbr = 8;
+  // How long a player who lost the connection keeps its place in the room to
+  // rejoin the game, in milliseconds.
+  static constexpr int kPlayerTtl = 30000;
+
   // network funcs
   Network(const ExitGames::Common::JString& appID,
           const ExitGames::Common::JString& appVersion, Game* game,
@@ -21,14 +27,51 @@ class Network final : public ExitGames::LoadBalancing::Listener {
 
   bool IsConnected() const noexcept { return is_connected_; }
 
+  // The round trip time to the server and its variance, in milliseconds.
+  int GetRoundTripTime() const noexcept {
+    return load_balancing_client_.getRoundTripTime();
+  }
+  int GetRoundTripTimeVariance() const noexcept {
+    return load_balancing_client_.getRoundTripTimeVariance();
+  }
+
+  // The game starts when this number of players joined the room, between
+  // metrics::kMinPlayerNbr and metrics::kMaxPlayerNbr.
+  void SetPlayerCount(int player_count) noexcept {
+    player_count_ = player_count;
+    transport_.SetPlayerCount(player_count);
+  }
+
   void JoinRandomOrCreateRoom() noexcept;
 
+  /**
+   * @brief Joins a room where the game already started, to watch it from the
+   * frames confirmed by the master client.
+   */
+  void JoinAsSpectator() noexcept;
+
+  [[nodiscard]] bool IsSpectator() const noexcept { return is_spectator_; }
+
   void LeaveRoom() noexcept;
 
-  void RaiseEvent(bool reliable, PacketType type,
-                  const ExitGames::Common::Hashtable& event_data) noexcept;
-  void ReceiveEvent(int player_nr, PacketType type,
-                    const ExitGames::Common::Hashtable& event_content) noexcept;
+  /**
+   * @brief Gets the transport of the packets between the players of the
+   * room, the peers are the player numbers.
+   */
+  [[nodiscard]] Transport& GetTransport() noexcept { return transport_; }
+
+  /**
+   * @brief Sends a reliable packet to every player and keeps it in the room
+   * so the players and spectators who join later receive it too.
+   */
+  void SendCached(const std::uint8_t* data, std::size_t size) {
+    transport_.SendCached(data, size);
+  }
+
+  /**
+   * @brief Drops the packets received but not read yet.
+   */
+  void ClearPackets() noexcept { transport_.Clear(); }
 
   // listener funcs
 
@@ -62,14 +105,24 @@ class Network final : public ExitGames::LoadBalancing::Listener {
   void joinRandomOrCreateRoomReturn(int, const ExitGames::Common::Hashtable&,
                                     const ExitGames::Common::Hashtable&, int,
                                     const ExitGames::Common::JString&) override;
+  void joinRandomRoomReturn(int, const ExitGames::Common::Hashtable&,
+                            const ExitGames::Common::Hashtable&, int,
+                            const ExitGames::Common::JString&) override;
 
  private:
   bool is_connected_ = false;
+  bool is_spectator_ = false;
+  int player_count_ = metrics::kMinPlayerNbr;
   ExitGames::LoadBalancing::Client load_balancing_client_;
+  PhotonTransport transport_{load_balancing_client_};
   ExitGames::Common::Logger
       mLogger;  // name must be mLogger because it is accessed by EGLOG()
   Application* app_;
   Game* game_;
   Renderer* renderer_;
   Rollback* rollback_;
+
+  [[nodiscard]] nByte GetRoomSize() const noexcept {
+    return static_cast<nByte>(player_count_ + kMaxSpectatorNbr);
+  }
 };
\ No newline at end of file
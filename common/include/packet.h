@@ -1,12 +1,57 @@
 #pragma once
 
-#include <Common-cpp/inc/Containers/Hashtable.h>
+#include <cstdint>
+#include <vector>
 
-enum class PacketType : nByte { kInput = 0, kFrame, kFrameConfirmation };
+#include "state_reader.h"
+#include "state_writer.h"
+#include "transport.h"
 
-enum class PacketKey : nByte { kInput = 0, kFrame, kChecksum };
+enum class PacketType : std::uint8_t {
+  kInput = 0,
+  kFrame,
+  kFrameConfirmation,
+  kMerkleRequest,
+  kMerkleReply,
+  kStateRequest,
+  kStateChunk,
+  kStateAck
+};
 
+/**
+ * @brief A packet received from another player. The payload is read with a
+ * StateReader, in the order the sender wrote it.
+ */
 struct Packet {
   PacketType type{};
-  ExitGames::Common::Hashtable data{};
-};
\ No newline at end of file
+  std::vector<std::uint8_t> data{};
+  int player_nbr = -1;  // The player that sent the packet.
+};
+
+/**
+ * @brief The encoding of the packets on a transport, independent of the
+ * network library: the type on one byte, then the payload.
+ */
+namespace packet {
+
+/**
+ * @brief Starts a packet, its payload is written after.
+ */
+void WriteType(StateWriter& writer, PacketType type);
+
+/**
+ * @brief Splits the bytes received from a transport in a type and a payload.
+ * @return false if the packet is empty or has an unknown type.
+ */
+[[nodiscard]] bool Decode(const TransportPacket& transport_packet,
+                          Packet& packet);
+
+// The arrays are written with their size first.
+void WriteInts(StateWriter& writer, const int* values, int count);
+void WriteBytes(StateWriter& writer, const std::uint8_t* values, int count);
+
+// A size larger than the rest of the payload fails the reader.
+[[nodiscard]] std::vector<int> ReadInts(StateReader& reader);
+[[nodiscard]] std::vector<std::uint8_t> ReadBytes(StateReader& reader);
+
+}  // namespace packet
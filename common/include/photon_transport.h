@@ -0,0 +1,75 @@
+#pragma once
+
+#include <LoadBalancing-cpp/inc/Client.h>
+
+#include <array>
+#include <deque>
+#include <vector>
+
+#include "Metrics.h"
+
+#include "transport.h"
+
+/**
+ * @brief A transport over the events of the Photon room, the packets are
+ * relayed by the Photon servers.
+ *
+ * Every packet is raised as a byte array with the same event code, the
+ * packets are received by Network::customEventAction which gives them to
+ * OnEvent.
+ */
+class PhotonTransport final : public Transport {
+ public:
+  static constexpr nByte kEventCode = 0;
+
+  explicit PhotonTransport(ExitGames::LoadBalancing::Client& client) noexcept
+      : client_(client) {}
+
+  void SendUnreliable(int peer, const std::uint8_t* data,
+                      std::size_t size) override;
+  void SendReliable(int peer, const std::uint8_t* data,
+                    std::size_t size) override;
+  bool Receive(TransportPacket& packet) override;
+  void Service() override { client_.service(); }
+
+  /**
+   * @brief Sets the number of players of the room, the packets to every peer
+   * are only sent to them and not to the spectators.
+   */
+  void SetPlayerCount(int player_count) noexcept {
+    player_count_ = player_count;
+  }
+
+  /**
+   * @brief Sends a reliable packet to every actor of the room, spectators
+   * included, and keeps it in the room so the ones who join later receive it
+   * too.
+   */
+  void SendCached(const std::uint8_t* data, std::size_t size);
+
+  /**
+   * @brief Queues the content of an event received from a player of the
+   * room.
+   * @param player_nbr The actor number of the sender minus one.
+   */
+  void OnEvent(int player_nbr, const ExitGames::Common::Object& content);
+
+  /**
+   * @brief Drops the packets not received yet, called when leaving a room.
+   */
+  void Clear() noexcept;
+
+ private:
+  ExitGames::LoadBalancing::Client& client_;
+  int player_count_ = metrics::kMinPlayerNbr;
+  // The actor numbers of the other players, the targets of a packet to every
+  // peer.
+  std::array<int, metrics::kMaxPlayerNbr> player_actor_nbrs_{};
+
+  std::deque<TransportPacket> received_packets_{};
+  // The buffers given back by Receive, reused for the next packets.
+  std::vector<std::vector<std::uint8_t>> free_buffers_{};
+
+  void RaiseEvent(bool reliable, int peer, const std::uint8_t* data,
+                  std::size_t size, bool is_cached);
+};
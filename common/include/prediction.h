@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "Input.h"
+#include "Metrics.h"
+
+/**
+ * @brief Base class of the strategies used by the rollback to guess the
+ * inputs of a remote player that have not been received yet.
+ *
+ * Every strategy also keeps track of how well it performed so different
+ * strategies can be compared on the same match.
+ */
+class PredictionStrategy {
+ public:
+  virtual ~PredictionStrategy() = default;
+
+  /**
+   * @brief Feeds the strategy with a received remote input. Inputs are given
+   * in frame order, one call per frame and per player.
+   * @param player_id The player that sent the input.
+   * @param input The input received for the next frame of the player.
+   */
+  void Observe(int player_id, input::Input input) noexcept;
+
+  /**
+   * @brief Predicts a remote input that has not been received yet.
+   * @param player_id The player whose input is predicted.
+   * @param last_input The last received input of the player.
+   * @param frames_ahead The number of frames between the last received input
+   * and the predicted one, always greater than zero.
+   * @return The predicted input.
+   */
+  [[nodiscard]] virtual input::Input Predict(
+      int player_id, input::Input last_input,
+      int frames_ahead) const noexcept = 0;
+
+  /**
+   * @brief Forgets everything learned and clears the statistics.
+   */
+  virtual void Reset() noexcept;
+
+  /**
+   * @brief Records whether a predicted input matched the received one.
+   */
+  void RecordPrediction(bool is_hit) noexcept;
+
+  /**
+   * @brief Records a rollback caused by a misprediction.
+   * @param depth The number of frames that were resimulated.
+   */
+  void RecordRollback(int depth) noexcept;
+
+  [[nodiscard]] float GetHitRate() const noexcept;
+  [[nodiscard]] float GetMispredictionsPerSecond() const noexcept;
+  [[nodiscard]] float GetAverageRollbackDepth() const noexcept;
+
+  /**
+   * @brief Gets the input bits of a player sorted from the one that changed
+   * the most often to the one that changed the least often.
+   */
+  [[nodiscard]] std::array<int, input::kBitCount> GetBitsByChangeCount(
+      int player_id) const noexcept;
+
+ protected:
+  /**
+   * @brief Called by Observe, lets the strategy learn from the received input.
+   */
+  virtual void OnObserve(int player_id, input::Input input) noexcept {}
+
+ private:
+  // The number of inputs observed for each player.
+  std::array<std::uint32_t, metrics::kMaxPlayerNbr> observed_frames_{};
+  std::uint32_t hit_count_ = 0;
+  std::uint32_t miss_count_ = 0;
+  std::uint32_t rollback_count_ = 0;
+  std::uint64_t rollback_depth_sum_ = 0;
+
+  // How many times each input bit of each player changed from one frame to
+  // the next.
+  std::array<std::array<std::uint32_t, input::kBitCount>,
+             metrics::kMaxPlayerNbr>
+      bit_change_counts_{};
+  std::array<input::Input, metrics::kMaxPlayerNbr> last_observed_inputs_{};
+};
+
+/**
+ * @brief Predicts that the remote player keeps pressing the same buttons.
+ */
+class RepeatLastPrediction final : public PredictionStrategy {
+ public:
+  [[nodiscard]] input::Input Predict(int player_id, input::Input last_input,
+                                     int frames_ahead) const noexcept override;
+};
+
+/**
+ * @brief Repeats the last input but releases the jump after a few frames,
+ * because a jump is a short press while moving is held.
+ */
+class ReleaseJumpPrediction final : public PredictionStrategy {
+ public:
+  static constexpr int kDefaultReleaseFrames = 3;
+
+  explicit ReleaseJumpPrediction(
+      int release_frames = kDefaultReleaseFrames) noexcept
+      : release_frames_(release_frames) {}
+
+  [[nodiscard]] input::Input Predict(int player_id, input::Input last_input,
+                                     int frames_ahead) const noexcept override;
+
+ private:
+  int release_frames_;
+};
+
+/**
+ * @brief Learns how long each button is usually held or released and
+ * predicts, bit per bit, whether the current state is more likely to last or
+ * to flip.
+ */
+class HoldDurationPrediction final : public PredictionStrategy {
+ public:
+  static constexpr int kInputBitCount = input::kBitCount;
+  // Runs longer than this are all counted in the last bucket.
+  static constexpr int kMaxRunLength = 64;
+
+  [[nodiscard]] input::Input Predict(int player_id, input::Input last_input,
+                                     int frames_ahead) const noexcept override;
+
+  void Reset() noexcept override;
+
+ protected:
+  void OnObserve(int player_id, input::Input input) noexcept override;
+
+ private:
+  // Number of finished runs per bit, per state (released, pressed) and per
+  // length.
+  using RunCounts =
+      std::array<std::array<std::array<std::uint32_t, kMaxRunLength + 1>, 2>,
+                 kInputBitCount>;
+
+  // The statistics are learned separately for every player.
+  std::array<RunCounts, metrics::kMaxPlayerNbr> run_counts_{};
+  std::array<std::array<int, kInputBitCount>, metrics::kMaxPlayerNbr>
+      current_runs_{};
+  std::array<input::Input, metrics::kMaxPlayerNbr> last_inputs_{};
+  std::array<bool, metrics::kMaxPlayerNbr> has_observed_{};
+
+  [[nodiscard]] std::uint32_t CountRunsAtLeast(int player_id, int bit,
+                                               int state,
+                                               int length) const noexcept;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Game.h"
+#include "Input.h"
+#include "Metrics.h"
+#include "confirmation_worker.h"
+
+/**
+ * @brief The confirmed inputs of a whole match and the checksums of its
+ * states, enough to simulate the match again without the network.
+ *
+ * The inputs are saved as runs of identical frames and only one checksum out
+ * of kChecksumInterval frames is kept, a match takes a few kilobytes.
+ */
+struct Replay {
+  using FrameInputs = std::array<input::Input, metrics::kMaxPlayerNbr>;
+
+  static constexpr std::uint32_t kMagic = 0x50524252;  // "RBRP"
+  static constexpr std::uint32_t kVersion = 1;
+  // The checksum of the frames kChecksumInterval - 1, 2 * kChecksumInterval
+  // - 1, etc. are kept, every half second.
+  static constexpr int kChecksumInterval = metrics::kFPS / 2;
+
+  int player_count = metrics::kMinPlayerNbr;
+  BallType ball_type = BallType::kFootball;
+  // The client that recorded the replay.
+  int player_nbr = -1;
+
+  // The inputs of every player at each frame from the start of the match.
+  std::vector<FrameInputs> inputs{};
+  std::vector<int> checksums{};
+
+  /**
+   * @brief Appends the next confirmed frame, the frames must be added in
+   * order from the first one.
+   * @return false if the frame does not follow the last added one.
+   */
+  bool AddFrame(const ConfirmedFrame& frame);
+
+  [[nodiscard]] int GetFrameCount() const noexcept {
+    return static_cast<int>(inputs.size());
+  }
+
+  /**
+   * @brief Checks if the checksum of a frame is kept in the replay.
+   */
+  [[nodiscard]] static bool HasChecksum(int frame_nbr) noexcept {
+    return frame_nbr % kChecksumInterval == kChecksumInterval - 1;
+  }
+
+  /**
+   * @brief Gets the checksum of a frame for which HasChecksum is true.
+   */
+  [[nodiscard]] int GetChecksum(int frame_nbr) const noexcept {
+    return checksums[frame_nbr / kChecksumInterval];
+  }
+
+  /**
+   * @brief Simulates the whole replay on a game from the start of the match
+   * and compares the checksums.
+   * @return The first frame whose checksum differs from the replay, or -1 if
+   * every checksum matches.
+   */
+  int Play(Game& game) const;
+
+  /**
+   * @brief Writes the replay to a file.
+   * @return false if the file cannot be written.
+   */
+  bool Save(const std::string& path) const;
+
+  /**
+   * @brief Reads a replay written by Save.
+   * @return false if the file cannot be read or is not a replay.
+   */
+  bool Load(const std::string& path);
+};
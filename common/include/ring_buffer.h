@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+
+/**
+ * @brief Fixed size circular buffer indexed by an ever increasing number,
+ * typically a frame number. Only the last Size indices are kept, older
+ * indices are overwritten by the new ones.
+ * @tparam T The type of the stored elements.
+ * @tparam Size The number of stored elements, must be a power of two so the
+ * index wraps with a mask instead of a modulo.
+ */
+template <typename T, int Size>
+class RingBuffer {
+  static_assert(Size > 0 && (Size & (Size - 1)) == 0,
+                "The size of a ring buffer must be a power of two.");
+
+ public:
+  static constexpr int kSize = Size;
+
+  [[nodiscard]] T& operator[](const int index) noexcept {
+    return data_[index & kMask];
+  }
+
+  [[nodiscard]] const T& operator[](const int index) const noexcept {
+    return data_[index & kMask];
+  }
+
+  void Fill(const T& value) noexcept { data_.fill(value); }
+
+ private:
+  static constexpr int kMask = Size - 1;
+
+  std::array<T, Size> data_{};
+};
@@ -1,66 +1,323 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 
 #include "Game.h"
-#include "metrics.h"
+#include "confirmation_worker.h"
+#include "Metrics.h"
+#include "prediction.h"
+#include "rollback_session.h"
+#include "rollback_telemetry.h"
+#include "speculation.h"
 
 class Rollback {
  public:
+  using Session = RollbackSession<Game, input::Input, metrics::kMaxPlayerNbr,
+                                  metrics::kMaxRollbackFrames>;
+
   void RegisterGame(Game* game) noexcept {
     current_ = game;
-    confirmed_.SetBallType(game->GetBallType());
-    confirmed_.StartGame();
-    confirmed_.player_nbr = current_->player_nbr;
+    const int player_count = game->GetPlayerCount();
+    session_.Start(game, player_count);
+
+    auto& confirmed = session_.GetConfirmedGame();
+    confirmed.SetBallType(game->GetBallType());
+    confirmed.SetPlayerCount(player_count);
+    confirmed.StartGame();
+    confirmed.player_nbr = current_->player_nbr;
+    // The confirmed game is only the starting point of the rollbacks.
+    confirmed.SetResimulating(true);
+    catch_up_game_.SetResimulating(true);
+    confirmation_worker_.Start(player_count, game->GetBallType());
+    if (speculation_ != nullptr) {
+      speculation_->Setup(player_count, game->GetBallType());
+    }
   }
 
   void SetPlayerInput(const input::FrameInput& frame_input, int player_id);
   void SetOtherPlayerInput(const std::vector<input::FrameInput>& frame_inputs,
                            int player_id);
 
-  void DoRollback() const noexcept;
+  void DoRollback() noexcept;
+
+  /**
+   * @brief Simulates the current frame on the registered game with the known
+   * or predicted inputs and keeps a snapshot of the resulting state.
+   */
+  void SimulateCurrentFrame() noexcept;
+
+  /**
+   * @brief Confirms the frame to confirm. The inputs of every player must be
+   * known for this frame. Its checksum is computed by the confirmation worker
+   * and published later, see PollConfirmedFrame.
+   */
+  void ConfirmFrame() noexcept;
 
-  int ConfirmFrame() noexcept;
+  /**
+   * @brief Gets the next confirmed frame whose checksum was computed by the
+   * confirmation worker, in frame order.
+   * @return false if no new checksum is available.
+   */
+  bool PollConfirmedFrame(ConfirmedFrame& confirmed_frame) noexcept {
+    return confirmation_worker_.TryPopChecksum(confirmed_frame);
+  }
+
+  /**
+   * @brief Copies the merkle tree of a recent frame whose checksum was
+   * computed by the confirmation worker.
+   * @return false if the frame is not computed yet or is too old.
+   */
+  bool CopyMerkleTree(int frame_nbr, MerkleTree& tree) const {
+    return confirmation_worker_.CopyMerkleTree(frame_nbr, tree);
+  }
+
+  /**
+   * @brief Copies the state of a recent confirmed frame whose checksum was
+   * computed by the confirmation worker, see Game::Serialize.
+   * @return false if the frame is not computed yet or is too old.
+   */
+  bool CopyConfirmedState(int frame_nbr,
+                          std::vector<std::uint8_t>& state) const {
+    return confirmation_worker_.CopyState(frame_nbr, state);
+  }
+
+  /**
+   * @brief Starts the rollback again from a confirmed state received from the
+   * master client after a desync or a reconnection. The registered game is
+   * loaded with the state and every input after it is forgotten.
+   * @param frame_nbr The confirmed frame after which the state was taken.
+   */
+  void RestoreConfirmedState(int frame_nbr, const Game& state);
+
+  /**
+   * @brief Simulates and confirms the frame after the current frame with the
+   * inputs confirmed by the master client, to catch up with the frames it
+   * confirmed while a state was transferred. The current frame must be the
+   * confirmed frame.
+   */
+  void ReplayConfirmedFrame(const ConfirmedFrame& confirmed_frame) noexcept;
+
+  /**
+   * @brief Gets the state after the confirmed frame, the one sent to a player
+   * who lost its own.
+   */
+  [[nodiscard]] const Game& GetConfirmedGame() const noexcept {
+    return session_.GetConfirmedGame();
+  }
+
+  /**
+   * @brief Limits the number of frames simulated again for the rollbacks
+   * during one rendered frame, whatever the number of fixed steps it runs.
+   * The frames over the budget are caught up during the next ones,
+   * meanwhile the registered game keeps going from its mispredicted state:
+   * a late input shows a bit later instead of the whole window being
+   * simulated in one frame. A confirmed frame is always caught up.
+   * @param frame_count The number of frames, 0 for no limit. A catch-up
+   * must simulate more frames than the one added each frame, so a budget
+   * is at least 2.
+   */
+  void SetResimulationBudget(int frame_count) noexcept {
+    resimulation_budget_ = frame_count <= 0 ? 0 : std::max(frame_count, 2);
+  }
+
+  /**
+   * @brief Gives the whole resimulation budget back, called once per
+   * rendered frame before its fixed steps.
+   */
+  void StartRenderFrame() noexcept { update_resimulated_frames_ = 0; }
+
+  /**
+   * @brief Checks if some simulated frames still have to be simulated again
+   * because a rollback was over the budget.
+   */
+  [[nodiscard]] bool IsCatchingUp() const noexcept {
+    return catch_up_frame_ != -1;
+  }
 
   const input::Input& GetLastPlayerInput(const int player_id) const noexcept;
 
-  [[nodiscard]] short GetConfirmedFrame() const noexcept {
-    return confirmed_frame_;
+  [[nodiscard]] input::Input GetPlayerInput(const int player_id,
+                                            const int frame) const noexcept {
+    return session_.GetInput(player_id, frame);
+  }
+
+  void SetPredictionStrategy(
+      std::unique_ptr<PredictionStrategy> prediction) noexcept {
+    prediction_ = std::move(prediction);
+  }
+
+  [[nodiscard]] const PredictionStrategy& GetPredictionStrategy()
+      const noexcept {
+    return *prediction_;
+  }
+
+  /**
+   * @brief Simulates alternative remote inputs on worker threads while they
+   * are predicted, so a misprediction can be fixed without resimulating on
+   * the calling thread. Must be called before RegisterGame.
+   * @param branch_count The number of alternative inputs simulated at the same
+   * time, each one on its own thread. Speculation is disabled when it is zero.
+   */
+  void EnableSpeculation(int branch_count) {
+    if (branch_count <= 0) {
+      speculation_.reset();
+      return;
+    }
+    speculation_ = std::make_unique<Speculation>(
+        std::min(branch_count, Speculation::kMaxBranchCount));
+  }
+
+  /**
+   * @brief Gets the rollback metrics, see RollbackTelemetry.
+   */
+  [[nodiscard]] const RollbackTelemetry& GetTelemetry() const noexcept {
+    return telemetry_;
+  }
+  [[nodiscard]] RollbackTelemetry& GetTelemetry() noexcept {
+    return telemetry_;
+  }
+
+  [[nodiscard]] int GetPlayerCount() const noexcept {
+    return session_.GetPlayerCount();
+  }
+
+  [[nodiscard]] int GetConfirmedFrame() const noexcept {
+    return session_.GetConfirmedFrame();
+  }
+  [[nodiscard]] int GetCurentFrame() const noexcept {
+    return session_.GetCurrentFrame();
+  }
+
+  [[nodiscard]] int GetSimulatedFrame() const noexcept {
+    return session_.GetSimulatedFrame();
+  }
+
+  [[nodiscard]] int GetLastInputFrame(const int player_id) const noexcept {
+    return session_.GetLastInputFrame(player_id);
+  }
+
+  /**
+   * @brief Gets the last frame for which the inputs of every player are
+   * known, the frames up to it can be confirmed.
+   */
+  [[nodiscard]] int GetConfirmationFrontier() const noexcept {
+    return session_.GetConfirmationFrontier();
   }
-  [[nodiscard]] short GetCurentFrame() const noexcept { return current_frame_; }
 
-  [[nodiscard]] short GetLastRemoteInputFrame() const noexcept {
-    return last_remote_input_frame_;
+  [[nodiscard]] int GetFrameToConfirm() const noexcept {
+    return session_.GetConfirmedFrame() + 1;
   }
 
-  [[nodiscard]] short GetFrameToConfirm() const noexcept {
-    return frame_to_confirm_;
+  /**
+   * @brief Checks if the current frame can move forward without overwriting
+   * inputs that are not confirmed yet. When it cannot, a remote player is
+   * too far behind and the local simulation must wait for it.
+   * @param input_delay The number of frames the local input of the next frame
+   * is scheduled ahead of it.
+   */
+  [[nodiscard]] bool CanIncreaseCurrentFrame(
+      int input_delay = 0) const noexcept {
+    return session_.CanIncreaseCurrentFrame(input_delay);
   }
 
-  void IncreaseCurrentFrame() noexcept { current_frame_++; }
+  void IncreaseCurrentFrame() noexcept;
 
   void Reset() noexcept {
-    current_frame_ = -1;
-    last_remote_input_frame_ = -1;
-    frame_to_confirm_ = 0;
-    confirmed_frame_ = -1;
-    last_inputs_[0] = 0;
-    last_inputs_[1] = 0;
-    inputs_[0].fill(0);
-    inputs_[1].fill(0);
-    confirmed_ = Game();
+    session_.Reset();
+    session_.GetConfirmedGame().Restart();
+    catch_up_frame_ = -1;
+    catch_up_bodies_ = 0;
+    update_resimulated_frames_ = 0;
+    confirmation_worker_.Stop();
+    prediction_->Reset();
+    telemetry_.Reset();
+    if (speculation_ != nullptr) {
+      speculation_->Reset();
+    }
   }
 
  private:
   Game* current_ = nullptr;
-  Game confirmed_{};
 
-  short current_frame_ = -1;
-  short last_remote_input_frame_ = -1;
-  short frame_to_confirm_ = 0;
-  short confirmed_frame_ = -1;
+  // The inputs, the snapshots and the confirmed state.
+  Session session_{};
+
+  std::unique_ptr<PredictionStrategy> prediction_ =
+      std::make_unique<RepeatLastPrediction>();
+
+  std::unique_ptr<Speculation> speculation_ = nullptr;
+
+  // Simulates the confirmed frames again on its own thread to compute their
+  // checksums.
+  ConfirmationWorker confirmation_worker_{};
+
+  RollbackTelemetry telemetry_{};
+
+  // The number of frames the rollbacks simulate again during one rendered
+  // frame, 0 for no limit.
+  int resimulation_budget_ = 0;
+  int update_resimulated_frames_ = 0;
+
+  // The first frame whose snapshot must still be simulated again, -1 when
+  // every snapshot is up to date, and the bodies that can differ from the
+  // snapshots from this frame.
+  int catch_up_frame_ = -1;
+  BodyMask catch_up_bodies_ = 0;
+
+  // Simulates the frames of a catch-up that does not reach the last
+  // simulated frame, the registered game keeps the displayed state.
+  Game catch_up_game_{};
+
+  /**
+   * @brief Simulates again the pending frames from the catch-up frame, at
+   * most frame_count of them. When the last simulated frame is reached, the
+   * registered game is up to date.
+   */
+  void CatchUp(int frame_count) noexcept;
+
+  [[nodiscard]] int GetResimulationBudgetLeft() const noexcept;
+
+  /**
+   * @brief Starts simulating the most likely alternatives to the prediction of
+   * the remote player that is the furthest behind, if the workers are idle.
+   */
+  void Speculate() noexcept;
+
+  /**
+   * @brief Finds a finished speculative branch that used the known or
+   * predicted inputs at each of its frames.
+   * @return The branch, or nullptr if none matches or the workers are busy.
+   */
+  [[nodiscard]] const SpeculativeBranch* FindMatchingBranch() const noexcept;
+
+  /**
+   * @brief Finds the first simulated frame with an input that is not the one
+   * it was simulated with.
+   * @param changed_bodies Set to the bodies of the players whose input
+   * changed.
+   * @return The frame, or the frame after the last simulated frame if every
+   * input is the same.
+   */
+  [[nodiscard]] int FindFirstChangedFrame(
+      BodyMask& changed_bodies) const noexcept;
 
-  std::array<input::Input, 2> last_inputs_{};
+  /**
+   * @brief Gets the bodies that the changed inputs can affect from the first
+   * frame: the changed bodies and every body that touched one of them,
+   * directly or through other bodies, in one of the simulated frames.
+   */
+  [[nodiscard]] BodyMask GetRollbackIsland(
+      int first_frame, BodyMask changed_bodies) const noexcept;
 
-  std::array<std::array<input::Input, metrics::kGameFrameNbr>, 2> inputs_{};
-};
\ No newline at end of file
+  /**
+   * @brief Simulates again the frames from the first to the last frame on a
+   * game. When the island is not the whole world, only its bodies are
+   * simulated and the rest of each frame is kept from its snapshot, until
+   * the island touches the rest of the world.
+   * @param base The state of the game before the first frame.
+   */
+  void ResimulateFrames(Game& game, const Game& base, int first_frame,
+                        int last_frame, BodyMask island) noexcept;
+};
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <type_traits>
+#include <utility>
+
+#include "ring_buffer.h"
+
+namespace rollback_requirements {
+
+template <typename TGame, typename = void>
+struct CanSaveAndLoad : std::false_type {};
+template <typename TGame>
+struct CanSaveAndLoad<TGame, std::void_t<decltype(std::declval<TGame&>().Copy(
+                                 std::declval<const TGame&>()))>>
+    : std::true_type {};
+
+template <typename TGame, typename TInput, typename = void>
+struct CanAdvance : std::false_type {};
+template <typename TGame, typename TInput>
+struct CanAdvance<
+    TGame, TInput,
+    std::void_t<decltype(std::declval<TGame&>().SetPlayerInput(
+                    0, std::declval<TInput>())),
+                decltype(std::declval<TGame&>().FixedUpdate())>>
+    : std::true_type {};
+
+template <typename TGame, typename = void>
+struct HasChecksum : std::false_type {};
+template <typename TGame>
+struct HasChecksum<TGame,
+                   std::void_t<decltype(std::declval<TGame&>().CheckSum())>>
+    : std::is_integral<decltype(std::declval<TGame&>().CheckSum())> {};
+
+}  // namespace rollback_requirements
+
+/**
+ * @brief The core of the rollback, independent of the game: the inputs of
+ * every player and the state of the game after each frame of the window, the
+ * resimulation and the confirmation of the frames.
+ *
+ * The game type must be able to:
+ * - save and load its state: void Copy(const TGame&), a snapshot is a TGame,
+ * - advance one frame: void SetPlayerInput(int, TInput) for each player then
+ *   void FixedUpdate(),
+ * - compute a checksum of its state: an integer CheckSum().
+ *
+ * The sizes are known at compile time, the inputs and the snapshots are kept
+ * in inline ring buffers, and the resimulation loop is compiled for the game
+ * type so its calls can be inlined. Only the ring buffer storage is inline: a
+ * snapshot is a TGame, it may own heap memory that Copy reuses or
+ * reallocates.
+ *
+ * The prediction of the missing inputs and what happens around a rollback
+ * are left to the owner of the session, see Rollback for the game.
+ *
+ * @tparam MaxPlayers The maximum number of players.
+ * @tparam MaxWindow The number of frames kept, the current frame cannot be
+ * more than MaxWindow frames after the confirmed frame. Must be a power of
+ * two.
+ */
+template <typename TGame, typename TInput, int MaxPlayers, int MaxWindow>
+class RollbackSession {
+  static_assert(rollback_requirements::CanSaveAndLoad<TGame>::value,
+                "The game must save and load its state with Copy.");
+  static_assert(rollback_requirements::CanAdvance<TGame, TInput>::value,
+                "The game must advance with SetPlayerInput and FixedUpdate.");
+  static_assert(rollback_requirements::HasChecksum<TGame>::value,
+                "The game must compute the checksum of its state.");
+  static_assert(std::is_trivially_copyable_v<TInput>,
+                "The inputs must be trivially copyable.");
+  static_assert(MaxPlayers > 0, "A session needs at least one player.");
+
+ public:
+  using FrameInputs = std::array<TInput, MaxPlayers>;
+
+  static constexpr int kMaxPlayers = MaxPlayers;
+  static constexpr int kMaxWindow = MaxWindow;
+
+  /**
+   * @brief Starts the session on the game that is rolled back. The confirmed
+   * game must be set up by the owner, see GetConfirmedGame.
+   */
+  void Start(TGame* game, int player_count) noexcept {
+    current_ = game;
+    player_count_ = std::clamp(player_count, 1, MaxPlayers);
+  }
+
+  /**
+   * @brief Forgets every input and frame, the games are left to the owner.
+   */
+  void Reset() noexcept {
+    current_frame_ = -1;
+    simulated_frame_ = -1;
+    confirmed_frame_ = -1;
+    last_input_frames_.fill(-1);
+    last_inputs_.fill(TInput{});
+    for (auto& player_inputs : inputs_) {
+      player_inputs.Fill(TInput{});
+    }
+  }
+
+  /**
+   * @brief Sets the known or predicted input of a player at a frame of the
+   * window.
+   */
+  void SetInput(int player_id, int frame_nbr, TInput input) noexcept {
+    inputs_[player_id][frame_nbr] = input;
+  }
+
+  [[nodiscard]] TInput GetInput(int player_id, int frame_nbr) const noexcept {
+    return inputs_[player_id][frame_nbr];
+  }
+
+  /**
+   * @brief Sets the last frame for which the input of a player is known.
+   */
+  void SetLastInput(int player_id, int frame_nbr, TInput input) noexcept {
+    last_input_frames_[player_id] = frame_nbr;
+    last_inputs_[player_id] = input;
+  }
+
+  [[nodiscard]] int GetLastInputFrame(int player_id) const noexcept {
+    return last_input_frames_[player_id];
+  }
+
+  [[nodiscard]] const TInput& GetLastInput(int player_id) const noexcept {
+    return last_inputs_[player_id];
+  }
+
+  /**
+   * @brief Gets the last frame for which the inputs of every player are
+   * known, the frames up to it can be confirmed.
+   */
+  [[nodiscard]] int GetConfirmationFrontier() const noexcept {
+    int frontier = last_input_frames_[0];
+    for (int player_id = 1; player_id < player_count_; player_id++) {
+      frontier = std::min(frontier, last_input_frames_[player_id]);
+    }
+    return frontier;
+  }
+
+  /**
+   * @brief Moves to the next frame and predicts the inputs that are not known
+   * for it.
+   * @param predict Gives the predicted input of a player from its last known
+   * input and the number of frames since it:
+   * TInput(int player_id, TInput last_input, int frame_count).
+   */
+  template <typename TPredict>
+  void IncreaseCurrentFrame(TPredict&& predict) noexcept {
+    current_frame_++;
+    for (int player_id = 0; player_id < player_count_; player_id++) {
+      const int last_input_frame = last_input_frames_[player_id];
+      if (current_frame_ <= last_input_frame) {
+        continue;
+      }
+      inputs_[player_id][current_frame_] =
+          predict(player_id, last_inputs_[player_id],
+                  current_frame_ - last_input_frame);
+    }
+  }
+
+  /**
+   * @brief Moves to the next frame, the missing inputs are predicted to be
+   * the last known ones.
+   */
+  void IncreaseCurrentFrame() noexcept {
+    IncreaseCurrentFrame(
+        [](int, TInput last_input, int) noexcept { return last_input; });
+  }
+
+  /**
+   * @brief Checks if the current frame can move forward without overwriting
+   * inputs that are not confirmed yet.
+   * @param input_delay The number of frames the local input of the next frame
+   * is scheduled ahead of it.
+   */
+  [[nodiscard]] bool CanIncreaseCurrentFrame(
+      int input_delay = 0) const noexcept {
+    return current_frame_ + 1 + input_delay - confirmed_frame_ <= MaxWindow;
+  }
+
+  /**
+   * @brief Simulates the current frame on the game and keeps a snapshot of
+   * the resulting state.
+   */
+  void SimulateCurrentFrame() noexcept {
+    AdvanceFrame(*current_, current_frame_);
+    snapshots_[current_frame_].Copy(*current_);
+    simulated_frame_ = current_frame_;
+  }
+
+  /**
+   * @brief Loads a state and simulates again the frames after it up to the
+   * last simulated frame with the current inputs.
+   * @param base The state of the game before the first frame.
+   * @param first_frame The first frame to simulate again.
+   */
+  void Resimulate(const TGame& base, int first_frame) noexcept {
+    current_->Copy(base);
+    ResimulateFrames(*current_, first_frame, simulated_frame_);
+  }
+
+  /**
+   * @brief Simulates again a range of frames on a game with the current
+   * inputs and replaces their snapshots, the game must hold the state before
+   * the first frame. Used to spread a long resimulation over several updates
+   * on a game that is not the one rolled back.
+   */
+  void ResimulateFrames(TGame& game, int first_frame, int last_frame) noexcept {
+    for (int frame = first_frame; frame <= last_frame; frame++) {
+      AdvanceFrame(game, frame);
+      snapshots_[frame].Copy(game);
+    }
+  }
+
+  /**
+   * @brief Confirms the frame after the confirmed frame, the inputs of every
+   * player must be known for it.
+   */
+  void ConfirmFrame() noexcept {
+    const int frame_to_confirm = confirmed_frame_ + 1;
+    if (frame_to_confirm <= simulated_frame_) {
+      // The frame was already simulated with the right inputs, promote its
+      // snapshot instead of simulating it again.
+      confirmed_.Copy(snapshots_[frame_to_confirm]);
+    } else {
+      AdvanceFrame(confirmed_, frame_to_confirm);
+    }
+    confirmed_frame_++;
+  }
+
+  /**
+   * @brief Starts the session again from a confirmed state received from
+   * another peer, every input is forgotten and the game that is rolled back
+   * is loaded with the state.
+   * @param frame_nbr The frame after which the state was taken, it becomes
+   * the confirmed, simulated and current frame.
+   */
+  void Restore(const TGame& state, int frame_nbr) noexcept {
+    Reset();
+    confirmed_.Copy(state);
+    if (current_ != &state) {
+      current_->Copy(state);
+    }
+    snapshots_[frame_nbr].Copy(state);
+    current_frame_ = frame_nbr;
+    simulated_frame_ = frame_nbr;
+    confirmed_frame_ = frame_nbr;
+  }
+
+  [[nodiscard]] int GetConfirmedChecksum() {
+    return static_cast<int>(confirmed_.CheckSum());
+  }
+
+  [[nodiscard]] TGame& GetConfirmedGame() noexcept { return confirmed_; }
+  [[nodiscard]] const TGame& GetConfirmedGame() const noexcept {
+    return confirmed_;
+  }
+
+  /**
+   * @brief Gets the state after a simulated frame of the window.
+   */
+  [[nodiscard]] TGame& GetSnapshot(int frame_nbr) noexcept {
+    return snapshots_[frame_nbr];
+  }
+  [[nodiscard]] const TGame& GetSnapshot(int frame_nbr) const noexcept {
+    return snapshots_[frame_nbr];
+  }
+
+  [[nodiscard]] int GetPlayerCount() const noexcept { return player_count_; }
+  [[nodiscard]] int GetCurrentFrame() const noexcept { return current_frame_; }
+  [[nodiscard]] int GetSimulatedFrame() const noexcept {
+    return simulated_frame_;
+  }
+  [[nodiscard]] int GetConfirmedFrame() const noexcept {
+    return confirmed_frame_;
+  }
+
+ private:
+  TGame* current_ = nullptr;
+  TGame confirmed_{};
+
+  int player_count_ = 1;
+
+  int current_frame_ = -1;
+  // The last frame simulated on the game, it is the current frame or the one
+  // before.
+  int simulated_frame_ = -1;
+  int confirmed_frame_ = -1;
+
+  // The last frame for which the input of each player is known.
+  std::array<int, MaxPlayers> last_input_frames_ = [] {
+    std::array<int, MaxPlayers> frames{};
+    frames.fill(-1);
+    return frames;
+  }();
+
+  std::array<TInput, MaxPlayers> last_inputs_{};
+
+  std::array<RingBuffer<TInput, MaxWindow>, MaxPlayers> inputs_{};
+
+  // The state of the game after each simulated frame. It is always computed
+  // from the known inputs because a misprediction triggers a rollback, so a
+  // snapshot becomes the confirmed state once all the inputs of its frame are
+  // known.
+  RingBuffer<TGame, MaxWindow> snapshots_{};
+
+  void AdvanceFrame(TGame& game, int frame_nbr) noexcept {
+    for (int player_id = 0; player_id < player_count_; player_id++) {
+      game.SetPlayerInput(player_id, inputs_[player_id][frame_nbr]);
+    }
+    game.FixedUpdate();
+  }
+};
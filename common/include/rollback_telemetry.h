@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "Metrics.h"
+
+/**
+ * @brief The rollback metrics measured over one second of game.
+ */
+struct RollbackStats {
+  float rollbacks_per_second = 0.f;
+  // The average number of frames resimulated by a rollback.
+  float average_rollback_depth = 0.f;
+  // The time spent in rollbacks and in frame confirmations during the second.
+  float rollback_time_ms = 0.f;
+  float confirmation_time_ms = 0.f;
+  // The ratio of predicted remote inputs that were right.
+  float prediction_hit_rate = 1.f;
+  // The number of frames between the current frame and the confirmed frame.
+  float average_confirmed_lag = 0.f;
+  int max_confirmed_lag = 0;
+};
+
+/**
+ * @brief Measures the rollbacks, the frame confirmations and the predictions,
+ * and publishes their metrics every second: through GetLastStats, as Tracy
+ * plots when Tracy is enabled, and as a row of a CSV file if one is open.
+ *
+ * The depth histogram tells apart many shallow rollbacks from rare deep ones,
+ * it is kept from the start of the game.
+ */
+class RollbackTelemetry {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using DepthHistogram =
+      std::array<std::uint32_t, metrics::kMaxRollbackFrames + 1>;
+
+  // The metrics are published every second of game.
+  static constexpr int kWindowFrames = metrics::kFPS;
+
+  RollbackTelemetry() = default;
+  ~RollbackTelemetry() { CloseCsv(); }
+
+  RollbackTelemetry(const RollbackTelemetry&) = delete;
+  RollbackTelemetry& operator=(const RollbackTelemetry&) = delete;
+
+  /**
+   * @param depth The number of frames that were resimulated.
+   * @param duration The time spent in the rollback.
+   */
+  void RecordRollback(int depth, Clock::duration duration) noexcept;
+
+  void RecordConfirmation(Clock::duration duration) noexcept;
+
+  void RecordPrediction(bool is_hit) noexcept;
+
+  /**
+   * @brief Ends a simulated frame, publishes the metrics every kWindowFrames
+   * frames.
+   */
+  void EndFrame(int current_frame, int confirmed_frame) noexcept;
+
+  /**
+   * @brief Writes the metrics of every second to a CSV file, starting with a
+   * header row.
+   * @return false if the file cannot be opened.
+   */
+  bool OpenCsv(const std::string& path);
+  void CloseCsv() noexcept;
+
+  /**
+   * @brief Clears the metrics of the game, the CSV file stays open.
+   */
+  void Reset() noexcept;
+
+  [[nodiscard]] const RollbackStats& GetLastStats() const noexcept {
+    return last_stats_;
+  }
+
+  /**
+   * @brief Gets the number of rollbacks for each number of resimulated frames
+   * since the start of the game.
+   */
+  [[nodiscard]] const DepthHistogram& GetDepthHistogram() const noexcept {
+    return depth_histogram_;
+  }
+
+  [[nodiscard]] std::uint32_t GetRollbackCount() const noexcept {
+    return rollback_count_;
+  }
+
+ private:
+  // What is measured during the current second.
+  struct Window {
+    int frame_count = 0;
+    std::uint32_t rollback_count = 0;
+    std::uint64_t depth_sum = 0;
+    Clock::duration rollback_time{};
+    Clock::duration confirmation_time{};
+    std::uint32_t hit_count = 0;
+    std::uint32_t miss_count = 0;
+    std::int64_t lag_sum = 0;
+    int max_lag = 0;
+  };
+
+  Window window_{};
+  RollbackStats last_stats_{};
+  DepthHistogram depth_histogram_{};
+  std::uint32_t rollback_count_ = 0;
+  // The number of published windows since the start of the game.
+  int window_count_ = 0;
+
+  std::ofstream csv_{};
+
+  void PublishWindow() noexcept;
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "Game.h"
+#include "Metrics.h"
+#include "state_writer.h"
+
+/**
+ * @brief The size and the cost of the snapshots saved in a SnapshotStore
+ * since its last reset.
+ */
+struct SnapshotStoreStats {
+  int save_count = 0;
+  int load_count = 0;
+  // The serialized size of the saved states and the size of what is kept.
+  std::uint64_t raw_bytes = 0;
+  std::uint64_t compressed_bytes = 0;
+  std::chrono::steady_clock::duration encode_time{};
+  std::chrono::steady_clock::duration decode_time{};
+
+  /**
+   * @brief Gets how many times the compressed snapshots are smaller than the
+   * serialized states.
+   */
+  [[nodiscard]] float GetCompressionRatio() const noexcept {
+    return compressed_bytes == 0 ? 0.f
+                                 : static_cast<float>(raw_bytes) /
+                                       static_cast<float>(compressed_bytes);
+  }
+
+  [[nodiscard]] float GetAverageEncodeMicroseconds() const noexcept;
+  [[nodiscard]] float GetAverageDecodeMicroseconds() const noexcept;
+};
+
+/**
+ * @brief Keeps the states of the last kCapacity frames compressed, for long
+ * rollback windows where full copies of the game take too much memory.
+ *
+ * One frame out of keyframe_interval is a keyframe, its serialized state is
+ * compressed with LZ4. The other frames are XORed with the state of their
+ * keyframe before being compressed: most of the state does not change in a
+ * few frames, so the delta is mostly zeros and compresses well. Restoring a
+ * frame decompresses its keyframe and its delta, a longer interval takes less
+ * memory but more time to restore a frame.
+ */
+class SnapshotStore {
+ public:
+  static constexpr int kCapacity = metrics::kMaxRollbackFrames;
+  static constexpr int kDefaultKeyframeInterval = 8;
+
+  explicit SnapshotStore(
+      int keyframe_interval = kDefaultKeyframeInterval) noexcept;
+
+  /**
+   * @brief Saves the state of a frame, it replaces the state of the same
+   * frame if it was already saved.
+   */
+  void Save(int frame_nbr, const Game& game);
+
+  /**
+   * @brief Restores the state of a saved frame on a started game with the
+   * same player count.
+   * @return false if the frame is not saved, too old, or its keyframe was
+   * saved again since.
+   */
+  bool Load(int frame_nbr, Game& game);
+
+  [[nodiscard]] int GetKeyframeInterval() const noexcept {
+    return keyframe_interval_;
+  }
+
+  [[nodiscard]] const SnapshotStoreStats& GetStats() const noexcept {
+    return stats_;
+  }
+
+  /**
+   * @brief Gets the memory taken by the compressed snapshots, in bytes.
+   */
+  [[nodiscard]] std::size_t GetMemorySize() const noexcept;
+
+  void Reset() noexcept;
+
+ private:
+  struct Entry {
+    int frame_nbr = -1;
+    // The keyframe the state is XORed with, -1 if the state is not a delta.
+    int keyframe_nbr = -1;
+    // Changes every time the entry is saved, a delta is only valid with the
+    // version of the keyframe it was computed from.
+    std::uint32_t version = 0;
+    std::uint32_t keyframe_version = 0;
+    std::size_t raw_size = 0;
+    std::vector<char> data{};
+  };
+
+  int keyframe_interval_;
+
+  // The keyframe of the oldest kept frame is kept too, it can be up to
+  // keyframe_interval_ - 1 frames older.
+  std::vector<Entry> entries_;
+
+  // The serialized state of the last saved or decompressed keyframe, the
+  // deltas are computed from it and applied to it.
+  std::vector<std::uint8_t> keyframe_state_{};
+  int keyframe_nbr_ = -1;
+  std::uint32_t keyframe_version_ = 0;
+  std::uint32_t last_version_ = 0;
+
+  // Keep their memory between two snapshots.
+  StateWriter writer_{};
+  std::vector<std::uint8_t> delta_{};
+  std::vector<char> compressed_{};
+
+  SnapshotStoreStats stats_{};
+
+  [[nodiscard]] Entry& GetEntry(int frame_nbr) noexcept {
+    return entries_[static_cast<std::size_t>(frame_nbr) % entries_.size()];
+  }
+
+  /**
+   * @brief Decompresses the keyframe of a delta in keyframe_state_ if it is
+   * not the one already there.
+   * @return false if the keyframe is not kept anymore.
+   */
+  bool LoadKeyframe(int keyframe_nbr, std::uint32_t keyframe_version);
+
+  void Compress(Entry& entry, const std::uint8_t* data, std::size_t size);
+  [[nodiscard]] static bool Decompress(const Entry& entry,
+                                       std::vector<std::uint8_t>& state);
+};
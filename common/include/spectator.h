@@ -0,0 +1,74 @@
+#pragma once
+
+#include <deque>
+
+#include "Game.h"
+#include "Metrics.h"
+#include "confirmation_worker.h"
+
+/**
+ * @brief Plays a match from the frames confirmed by the master client, a
+ * little behind the players.
+ *
+ * The confirmed inputs are final, so a spectator never predicts nor rolls
+ * back: it costs one fixed update per frame. It keeps a buffer of confirmed
+ * frames to absorb the jitter, and catches up a few frames per tick when it
+ * joined late or fell behind.
+ */
+class Spectator {
+ public:
+  // The spectator waits for this many confirmed frames before it starts to
+  // play, and tries to stay this far behind the last confirmed frame.
+  static constexpr int kDelayFrames = metrics::kFPS / 2;
+  // The maximum number of frames simulated in one tick to catch up.
+  static constexpr int kMaxCatchUpFrames = 4;
+  // The match is over for the spectator when no frame is confirmed for this
+  // long, the players left before confirming the last frames.
+  static constexpr int kMaxStallFrames = 5 * metrics::kFPS;
+  // The checksum of one frame out of this interval is checked.
+  static constexpr int kChecksumInterval = metrics::kFPS / 2;
+
+  /**
+   * @brief Starts spectating on a started game.
+   */
+  void Start(Game* game) noexcept;
+
+  /**
+   * @brief Adds a frame confirmed by the master client with its inputs and
+   * checksum.
+   * @return false if the frame does not follow the last added one, the
+   * duplicated frames are ignored.
+   */
+  bool AddConfirmedFrame(const ConfirmedFrame& confirmed_frame);
+
+  /**
+   * @brief Simulates the frames to play during a fixed step.
+   */
+  void Update() noexcept;
+
+  /**
+   * @brief Checks if the spectator played the whole match or if the
+   * confirmations stopped.
+   */
+  [[nodiscard]] bool IsFinished() const noexcept;
+
+  /**
+   * @brief Gets the last frame simulated by the spectator.
+   */
+  [[nodiscard]] int GetFrame() const noexcept { return simulated_frame_; }
+
+  void Reset() noexcept;
+
+ private:
+  Game* game_ = nullptr;
+
+  // The confirmed frames that are not played yet, in frame order.
+  std::deque<ConfirmedFrame> frames_{};
+  int last_confirmed_frame_ = -1;
+  int simulated_frame_ = -1;
+
+  bool is_playing_ = false;
+  int stall_frames_ = 0;
+
+  void SimulateNextFrame() noexcept;
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Game.h"
+#include "Input.h"
+#include "Metrics.h"
+#include "ring_buffer.h"
+
+/**
+ * @brief A timeline simulated ahead of time from a known state, with an
+ * alternative input for a remote player whose input is still predicted.
+ */
+struct SpeculativeBranch {
+  using FrameInputs = std::array<input::Input, metrics::kMaxPlayerNbr>;
+
+  // The state of the game after the end frame.
+  Game game{};
+
+  // The frame of the known state the branch starts from.
+  int base_frame = -1;
+
+  // The last frame simulated by the branch, the branch is empty when it is not
+  // greater than the base frame.
+  int end_frame = -1;
+
+  // The inputs of every player used at each frame of the branch.
+  RingBuffer<FrameInputs, metrics::kMaxRollbackFrames> inputs{};
+
+  // The state of the game after each frame of the branch.
+  RingBuffer<Game, metrics::kMaxRollbackFrames> snapshots{};
+
+  [[nodiscard]] bool IsEmpty() const noexcept {
+    return end_frame <= base_frame;
+  }
+};
+
+/**
+ * @brief Simulates speculative branches on worker threads, one thread per
+ * branch, so the rollback can adopt a branch when a late remote input
+ * contradicts its prediction instead of resimulating on the main thread.
+ *
+ * The branches belong to the main thread while the speculation is not
+ * running, and to the workers while it is.
+ */
+class Speculation {
+ public:
+  // Only the inputs that differ by one bit from the prediction are speculated.
+  static constexpr int kMaxBranchCount = input::kBitCount;
+
+  explicit Speculation(int branch_count);
+  ~Speculation();
+
+  Speculation(const Speculation&) = delete;
+  Speculation& operator=(const Speculation&) = delete;
+
+  /**
+   * @brief Starts the games of the branches so they can simulate a game of
+   * the given player count and ball type. Empties every branch.
+   */
+  void Setup(int player_count, BallType ball_type) noexcept;
+
+  /**
+   * @brief Starts simulating the non-empty branches on the workers.
+   */
+  void Run() noexcept;
+
+  /**
+   * @brief Waits for the workers and empties every branch.
+   */
+  void Reset() noexcept;
+
+  [[nodiscard]] bool IsRunning() const noexcept {
+    return running_count_.load(std::memory_order_acquire) > 0;
+  }
+
+  [[nodiscard]] int GetBranchCount() const noexcept {
+    return static_cast<int>(branches_.size());
+  }
+
+  /**
+   * @brief Gets a branch, it must not be accessed while the speculation is
+   * running.
+   */
+  [[nodiscard]] SpeculativeBranch& GetBranch(int index) noexcept {
+    return branches_[index];
+  }
+  [[nodiscard]] const SpeculativeBranch& GetBranch(int index) const noexcept {
+    return branches_[index];
+  }
+
+ private:
+  std::vector<SpeculativeBranch> branches_;
+  std::vector<std::thread> workers_;
+
+  int player_count_ = metrics::kMinPlayerNbr;
+
+  std::mutex mutex_;
+  std::condition_variable run_condition_;
+  // Increased every time the branches are run so each worker wakes up once.
+  std::uint32_t run_count_ = 0;
+  bool is_stopping_ = false;
+
+  // The number of workers still simulating their branch.
+  std::atomic<int> running_count_{0};
+
+  void WorkerLoop(int branch_index) noexcept;
+  void Simulate(SpeculativeBranch& branch) const noexcept;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Lock-free bounded queue with a single producer thread and a single
+ * consumer thread.
+ * @tparam T The type of the queued elements.
+ * @tparam Size The maximum number of queued elements, must be a power of two
+ * so the indices wrap with a mask instead of a modulo.
+ */
+template <typename T, int Size>
+class SpscQueue {
+  static_assert(Size > 0 && (Size & (Size - 1)) == 0,
+                "The size of a spsc queue must be a power of two.");
+
+ public:
+  /**
+   * @brief Adds an element at the back of the queue, only called by the
+   * producer.
+   * @return false if the queue is full.
+   */
+  bool TryPush(const T& value) noexcept {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == Size) {
+      return false;
+    }
+
+    data_[tail & kMask] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Removes the element at the front of the queue, only called by the
+   * consumer.
+   * @return false if the queue is empty.
+   */
+  bool TryPop(T& value) noexcept {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    value = data_[head & kMask];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  [[nodiscard]] bool IsEmpty() const noexcept {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+ private:
+  static constexpr std::uint32_t kMask = Size - 1;
+
+  std::array<T, Size> data_{};
+
+  // The producer and the consumer each write their own index, keep them on
+  // different cache lines.
+  alignas(64) std::atomic<std::uint32_t> head_{0};
+  alignas(64) std::atomic<std::uint32_t> tail_{0};
+};
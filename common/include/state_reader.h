@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Body.h"
+#include "Collider.h"
+#include "Vec2.h"
+
+/**
+ * @brief Reads back the bytes written by a StateWriter, in the same order.
+ *
+ * Reading past the end of the data does not throw: it returns zeros and
+ * marks the reader as failed, so the caller checks HasFailed once at the end.
+ */
+class StateReader {
+ public:
+  StateReader(const std::uint8_t* data, std::size_t size) noexcept
+      : data_(data), size_(size) {}
+
+  explicit StateReader(const std::vector<std::uint8_t>& data) noexcept
+      : StateReader(data.data(), data.size()) {}
+
+  std::uint8_t ReadU8() noexcept {
+    if (position_ + 1 > size_) {
+      has_failed_ = true;
+      return 0;
+    }
+    return data_[position_++];
+  }
+
+  std::uint32_t ReadU32() noexcept {
+    std::uint32_t value = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+      value |= static_cast<std::uint32_t>(ReadU8()) << shift;
+    }
+    return value;
+  }
+
+  int ReadInt() noexcept { return static_cast<int>(ReadU32()); }
+
+  bool ReadBool() noexcept { return ReadU8() != 0; }
+
+  float ReadFloat() noexcept {
+    const std::uint32_t bits = ReadU32();
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  Math::Vec2F ReadVec2() noexcept {
+    const float x = ReadFloat();
+    const float y = ReadFloat();
+    return {x, y};
+  }
+
+  Body ReadBody() noexcept {
+    Body body;
+    body.Mass = ReadFloat();
+    if (!body.IsEnabled()) {
+      return body;
+    }
+    body.Type = static_cast<BodyType>(ReadU8());
+    body.Position = ReadVec2();
+    body.Velocity = ReadVec2();
+    body.ApplyForce(ReadVec2());
+    return body;
+  }
+
+  Collider ReadCollider() {
+    Collider collider;
+    collider.IsAttached = ReadBool();
+    if (!collider.IsAttached) {
+      return collider;
+    }
+    collider.BodyRef.Index = ReadU32();
+    collider.BodyRef.GenIndex = ReadU32();
+    collider.BodyPosition = ReadVec2();
+    collider.Restitution = ReadFloat();
+    collider.IsTrigger = ReadBool();
+
+    switch (ReadU8()) {
+      case 0: {
+        const auto center = ReadVec2();
+        collider.Shape = Math::CircleF(center, ReadFloat());
+      } break;
+      case 1: {
+        const auto min_bound = ReadVec2();
+        collider.Shape = Math::RectangleF(min_bound, ReadVec2());
+      } break;
+      case 2: {
+        const auto vertex_count = ReadU32();
+        if (vertex_count > GetRemainingSize() / (2 * sizeof(float))) {
+          has_failed_ = true;
+          break;
+        }
+        std::vector<Math::Vec2F> vertices(vertex_count);
+        for (auto& vertex : vertices) {
+          vertex = ReadVec2();
+        }
+        collider.Shape = Math::PolygonF(vertices);
+      } break;
+      default:
+        has_failed_ = true;
+        break;
+    }
+    return collider;
+  }
+
+  [[nodiscard]] bool HasFailed() const noexcept { return has_failed_; }
+
+  /**
+   * @brief Marks the reader as failed when a value read is not valid.
+   */
+  void SetFailed() noexcept { has_failed_ = true; }
+
+  [[nodiscard]] std::size_t GetRemainingSize() const noexcept {
+    return size_ - position_;
+  }
+
+ private:
+  const std::uint8_t* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::size_t position_ = 0;
+  bool has_failed_ = false;
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "Game.h"
+#include "state_writer.h"
+
+/**
+ * @brief A part of a compressed state, small enough for one unreliable
+ * packet. Every chunk carries what the receiver needs to start the transfer,
+ * so they can arrive in any order.
+ */
+struct StateChunk {
+  // A new transfer replaces the previous one.
+  int transfer_id = -1;
+  // The confirmed frame of the state.
+  int frame_nbr = -1;
+  int chunk_index = 0;
+  int chunk_count = 0;
+  // The size of the serialized state and its CRC32C, checked once it is
+  // decompressed.
+  int raw_size = 0;
+  std::uint32_t checksum = 0;
+  std::vector<char> data{};
+};
+
+/**
+ * @brief Sends the confirmed state of a frame to a peer that lost its own,
+ * after a desync or a reconnection, over an unreliable channel.
+ *
+ * The serialized state is compressed with LZ4 and split in chunks. The
+ * receiver acknowledges the chunks it has, the ones that are not acknowledged
+ * are sent again after kResendDelay, until every chunk is acknowledged or one
+ * was sent kMaxSendCount times.
+ */
+class StateTransferSender {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr int kChunkSize = 1024;
+  static constexpr Clock::duration kResendDelay =
+      std::chrono::milliseconds(100);
+  static constexpr int kMaxSendCount = 50;
+  // The most chunks sent at once, to not flood the channel.
+  static constexpr int kMaxChunksPerSend = 8;
+
+  /**
+   * @brief Starts sending the state of a game, replaces the transfer in
+   * progress if any.
+   */
+  void Start(int transfer_id, int frame_nbr, const Game& game);
+
+  /**
+   * @brief Gets the chunks to send now, at most kMaxChunksPerSend: the ones
+   * never sent and the ones whose last send was not acknowledged after
+   * kResendDelay.
+   */
+  void GetChunksToSend(Clock::time_point now, std::vector<StateChunk>& chunks);
+
+  /**
+   * @brief Marks the chunks the receiver has, the acknowledgments of another
+   * transfer are ignored.
+   */
+  void OnAck(int transfer_id, const std::vector<int>& chunk_indices) noexcept;
+
+  /**
+   * @brief Checks if chunks are still to be acknowledged.
+   */
+  [[nodiscard]] bool IsActive() const noexcept { return is_active_; }
+
+  /**
+   * @brief Checks if the last transfer stopped because a chunk was never
+   * acknowledged.
+   */
+  [[nodiscard]] bool HasFailed() const noexcept { return has_failed_; }
+
+  [[nodiscard]] int GetTransferId() const noexcept { return transfer_id_; }
+
+  /**
+   * @brief Stops the transfer in progress.
+   */
+  void Reset() noexcept {
+    is_active_ = false;
+    has_failed_ = false;
+  }
+
+ private:
+  struct ChunkState {
+    bool is_acked = false;
+    int send_count = 0;
+    Clock::time_point last_send_time{};
+  };
+
+  int transfer_id_ = -1;
+  int frame_nbr_ = -1;
+  int raw_size_ = 0;
+  std::uint32_t checksum_ = 0;
+  bool is_active_ = false;
+  bool has_failed_ = false;
+
+  std::vector<char> compressed_{};
+  std::vector<ChunkState> chunk_states_{};
+
+  // Keeps its memory between two transfers.
+  StateWriter writer_{};
+
+  [[nodiscard]] int GetChunkCount() const noexcept {
+    return static_cast<int>(chunk_states_.size());
+  }
+};
+
+/**
+ * @brief Puts a state sent by a StateTransferSender back together and loads
+ * it once every chunk arrived.
+ */
+class StateTransferReceiver {
+ public:
+  /**
+   * @brief Adds a received chunk. A chunk of a newer transfer replaces the
+   * transfer in progress, the chunks of an older one are ignored.
+   * @return false if the chunk is ignored or is not consistent with the other
+   * chunks of its transfer.
+   */
+  bool AddChunk(const StateChunk& chunk);
+
+  /**
+   * @brief Gets the index of every chunk received for the transfer in
+   * progress, sent back as the acknowledgment.
+   */
+  [[nodiscard]] const std::vector<int>& GetReceivedChunks() const noexcept {
+    return received_chunks_;
+  }
+
+  [[nodiscard]] bool IsComplete() const noexcept {
+    return chunk_count_ > 0 &&
+           static_cast<int>(received_chunks_.size()) == chunk_count_;
+  }
+
+  [[nodiscard]] int GetTransferId() const noexcept { return transfer_id_; }
+  [[nodiscard]] int GetFrame() const noexcept { return frame_nbr_; }
+
+  /**
+   * @brief Decompresses the complete state, checks its CRC32C and loads it on
+   * a started game with the same player count.
+   * @return false if the state is not complete or not valid, the game is
+   * unchanged.
+   */
+  bool Load(Game& game);
+
+  /**
+   * @brief Forgets the transfer in progress, the chunks of any transfer are
+   * accepted again.
+   */
+  void Reset() noexcept;
+
+ private:
+  int transfer_id_ = -1;
+  int frame_nbr_ = -1;
+  int chunk_count_ = 0;
+  int raw_size_ = 0;
+  std::uint32_t checksum_ = 0;
+
+  std::vector<std::vector<char>> chunks_{};
+  std::vector<int> received_chunks_{};
+
+  // Keep their memory between two transfers.
+  std::vector<char> compressed_{};
+  std::vector<std::uint8_t> state_{};
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <variant>
+#include <vector>
+
+#include "Body.h"
+#include "Collider.h"
+#include "Vec2.h"
+
+/**
+ * @brief Serializes a game state into a canonical sequence of bytes, two
+ * identical states give the same bytes on every platform.
+ *
+ * Every value is written in little endian with a fixed size, and floats are
+ * written with their exact bits so the smallest divergence is visible.
+ */
+class StateWriter {
+ public:
+  void WriteU8(std::uint8_t value) { data_.push_back(value); }
+
+  void WriteU32(std::uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+      data_.push_back(static_cast<std::uint8_t>(value >> shift));
+    }
+  }
+
+  void WriteInt(int value) { WriteU32(static_cast<std::uint32_t>(value)); }
+
+  void WriteBool(bool value) { WriteU8(value ? 1 : 0); }
+
+  void WriteFloat(float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    WriteU32(bits);
+  }
+
+  void WriteVec2(Math::Vec2F value) {
+    WriteFloat(value.X);
+    WriteFloat(value.Y);
+  }
+
+  void WriteBody(const Body& body) {
+    WriteFloat(body.Mass);
+    if (!body.IsEnabled()) {
+      return;
+    }
+    WriteU8(static_cast<std::uint8_t>(body.Type));
+    WriteVec2(body.Position);
+    WriteVec2(body.Velocity);
+    WriteVec2(body.GetForce());
+  }
+
+  void WriteCollider(const Collider& collider) {
+    WriteBool(collider.IsAttached);
+    if (!collider.IsAttached) {
+      return;
+    }
+    WriteU32(static_cast<std::uint32_t>(collider.BodyRef.Index));
+    WriteU32(static_cast<std::uint32_t>(collider.BodyRef.GenIndex));
+    WriteVec2(collider.BodyPosition);
+    WriteFloat(collider.Restitution);
+    WriteBool(collider.IsTrigger);
+
+    WriteU8(static_cast<std::uint8_t>(collider.Shape.index()));
+    if (const auto* circle = std::get_if<Math::CircleF>(&collider.Shape)) {
+      WriteVec2(circle->origin());
+      WriteFloat(circle->Radius());
+    } else if (const auto* rectangle =
+                   std::get_if<Math::RectangleF>(&collider.Shape)) {
+      WriteVec2(rectangle->MinBound());
+      WriteVec2(rectangle->MaxBound());
+    } else if (const auto* polygon =
+                   std::get_if<Math::PolygonF>(&collider.Shape)) {
+      const auto vertices = polygon->Vertices();
+      WriteU32(static_cast<std::uint32_t>(vertices.size()));
+      for (const auto& vertex : vertices) {
+        WriteVec2(vertex);
+      }
+    }
+  }
+
+  /**
+   * @brief Removes the written bytes but keeps the memory for the next state.
+   */
+  void Clear() noexcept { data_.clear(); }
+
+  [[nodiscard]] const std::uint8_t* GetData() const noexcept {
+    return data_.data();
+  }
+
+  [[nodiscard]] std::size_t GetSize() const noexcept { return data_.size(); }
+
+ private:
+  std::vector<std::uint8_t> data_{};
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+
+#include "Game.h"
+#include "Input.h"
+#include "Metrics.h"
+#include "ring_buffer.h"
+#include "rollback_telemetry.h"
+
+/**
+ * @brief An offline session that rolls back every frame to find the
+ * non-determinism of the simulation without a network, like the SyncTest
+ * session of GGPO.
+ *
+ * Each frame is simulated and its checksum kept, then the game goes back
+ * rollback_depth frames and simulates them again with the same inputs, the
+ * way a rollback does. The checksums of the simulated frames must match the
+ * ones computed the first time. Since every frame pays the deepest rollback,
+ * it is also the worst case of the rollback for the CPU.
+ *
+ * In island mode, each frame also changes the input of one player at the
+ * first rolled back frame. The frames after it are simulated for the island
+ * of bodies the change can reach only, the way the rollback does, and must
+ * give the same checksums as the whole world simulated with the changed
+ * input.
+ */
+class SyncTest {
+ public:
+  using FrameInputs = std::array<input::Input, metrics::kMaxPlayerNbr>;
+
+  /**
+   * @brief Starts a new game on which every frame is rolled back.
+   * @param rollback_depth The number of frames simulated again each frame,
+   * between 1 and metrics::kMaxRollbackFrames - 1.
+   * @param is_island_mode Also checks the rollback of an island every frame.
+   */
+  void Start(int player_count, BallType ball_type, int rollback_depth,
+             bool is_island_mode = false);
+
+  /**
+   * @brief Simulates the next frame with the inputs of every player, then
+   * rolls back and simulates again the last rollback_depth frames.
+   * @return false if a simulated frame does not have the same checksum as
+   * the first time, see GetDivergentFrame.
+   */
+  bool AdvanceFrame(const FrameInputs& inputs) noexcept;
+
+  [[nodiscard]] int GetFrame() const noexcept { return current_frame_; }
+
+  [[nodiscard]] int GetRollbackDepth() const noexcept {
+    return rollback_depth_;
+  }
+
+  /**
+   * @brief Gets the first frame whose checksum differed when it was
+   * simulated again, or -1 if every checksum matched.
+   */
+  [[nodiscard]] int GetDivergentFrame() const noexcept {
+    return divergent_frame_;
+  }
+
+  /**
+   * @brief Gets the number of rollbacks of the island mode simulated for an
+   * island only, the others reached every body or left their island and
+   * were simulated whole.
+   */
+  [[nodiscard]] int GetIslandRollbackCount() const noexcept {
+    return island_rollback_count_;
+  }
+  [[nodiscard]] int GetWholeRollbackCount() const noexcept {
+    return whole_rollback_count_;
+  }
+
+  [[nodiscard]] const RollbackTelemetry& GetTelemetry() const noexcept {
+    return telemetry_;
+  }
+  [[nodiscard]] RollbackTelemetry& GetTelemetry() noexcept {
+    return telemetry_;
+  }
+
+ private:
+  Game game_{};
+
+  int player_count_ = metrics::kMinPlayerNbr;
+  int rollback_depth_ = 1;
+
+  bool is_island_mode_ = false;
+  int island_rollback_count_ = 0;
+  int whole_rollback_count_ = 0;
+  // The frames simulated with the changed input, whole and for the island.
+  Game whole_game_{};
+  Game island_game_{};
+  Game island_snapshot_{};
+
+  int current_frame_ = -1;
+  int divergent_frame_ = -1;
+
+  // The inputs, the state and the checksum of each simulated frame.
+  RingBuffer<FrameInputs, metrics::kMaxRollbackFrames> inputs_{};
+  RingBuffer<Game, metrics::kMaxRollbackFrames> snapshots_{};
+  RingBuffer<int, metrics::kMaxRollbackFrames> checksums_{};
+
+  RollbackTelemetry telemetry_{};
+
+  void SetInputs(int frame_nbr) noexcept;
+
+  /**
+   * @brief Simulates again the frames after the one to go back to.
+   * @return false if a checksum differs from the first simulation.
+   */
+  bool DoRollback(int first_frame) noexcept;
+
+  /**
+   * @brief Changes the input of a player at the first frame and compares the
+   * frames after it simulated for the island of bodies it can reach with the
+   * same frames simulated whole. The kept snapshots are not modified.
+   * @return false if a checksum differs.
+   */
+  bool CheckIslandRollback(int first_frame, int player_id) noexcept;
+
+  [[nodiscard]] BodyMask GetIsland(int first_frame,
+                                   BodyMask changed_bodies) const noexcept;
+};
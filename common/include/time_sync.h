@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+
+#include "Metrics.h"
+#include "ring_buffer.h"
+
+/**
+ * @brief Keeps the peers on the same frame, the way GGPO does.
+ *
+ * Each peer sends its current frame and its advantage over every other peer
+ * with its inputs. A peer that runs ahead of another makes it roll back at
+ * every packet, so the peer that is ahead stretches its fixed step until the
+ * advantage is balanced. Half of the difference between the local and the
+ * remote advantages is used, so the latency estimate cancels out.
+ */
+class TimeSync {
+ public:
+  // The advantages are averaged over this number of frames, it must be a
+  // power of two.
+  static constexpr int kWindowSize = 32;
+  // Smaller advantages are within the noise of the measure.
+  static constexpr float kMinAdvantage = 1.f;
+  // The fixed step is stretched by this ratio for each frame of advantage,
+  // up to kMaxStepScale where every other tick is skipped.
+  static constexpr float kStretchPerFrame = 0.05f;
+  static constexpr float kMaxStepScale = 2.f;
+
+  /**
+   * @brief Records the frame and the advantage sent by a remote player.
+   * @param remote_advantage The advantage of the remote player over the
+   * local one, as measured by the remote player.
+   */
+  void OnRemoteFrame(int player_id, int remote_frame,
+                     int remote_advantage) noexcept;
+
+  /**
+   * @brief Measures the local advantage over every remote player, called
+   * once per frame.
+   * @param round_trip_time The round trip time to the server, in
+   * milliseconds.
+   */
+  void Update(int local_frame, int round_trip_time) noexcept;
+
+  /**
+   * @brief Gets the last measured advantage of the local player over a
+   * remote player, sent to the remote players.
+   */
+  [[nodiscard]] int GetLocalAdvantage(int player_id) const noexcept {
+    return local_advantages_[player_id];
+  }
+
+  /**
+   * @brief Gets the number of frames the local player should give up to be
+   * balanced with the remote player it is the most ahead of.
+   */
+  [[nodiscard]] float GetFrameAdvantage() const noexcept;
+
+  /**
+   * @brief Gets the ratio to apply to the duration of the fixed step, one
+   * when the peers are balanced.
+   */
+  [[nodiscard]] float GetStepScale() const noexcept;
+
+  void Reset() noexcept;
+
+ private:
+  // The last current frame received from each player, -1 if none.
+  std::array<int, metrics::kMaxPlayerNbr> remote_frames_ = [] {
+    std::array<int, metrics::kMaxPlayerNbr> frames{};
+    frames.fill(-1);
+    return frames;
+  }();
+  std::array<int, metrics::kMaxPlayerNbr> remote_advantages_{};
+  std::array<int, metrics::kMaxPlayerNbr> local_advantages_{};
+
+  // The local minus the remote advantage at each frame of the window, their
+  // sum and their number, for each player.
+  std::array<RingBuffer<int, kWindowSize>, metrics::kMaxPlayerNbr>
+      advantage_differences_{};
+  std::array<int, metrics::kMaxPlayerNbr> difference_sums_{};
+  std::array<int, metrics::kMaxPlayerNbr> sample_counts_{};
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief A datagram received from a peer.
+ */
+struct TransportPacket {
+  // The player number of the peer that sent the packet.
+  int peer = -1;
+  std::vector<std::uint8_t> data{};
+};
+
+/**
+ * @brief Sends and receives the datagrams of the game between the peers of a
+ * session, independently of the network library.
+ *
+ * The peers are the player numbers of the session. The unreliable packets
+ * may be lost, duplicated or reordered. The reliable packets all arrive, in
+ * the order they were sent to the same peer.
+ *
+ * A transport is used from one thread: the packets are sent and received by
+ * Service, and Receive only returns the packets already received.
+ */
+class Transport {
+ public:
+  // Sends a packet to every peer of the session but us.
+  static constexpr int kAllPeers = -1;
+
+  virtual ~Transport() = default;
+
+  virtual void SendUnreliable(int peer, const std::uint8_t* data,
+                              std::size_t size) = 0;
+  virtual void SendReliable(int peer, const std::uint8_t* data,
+                            std::size_t size) = 0;
+
+  /**
+   * @brief Gets the next received packet. Its buffer is swapped with the one
+   * of the given packet, which is reused for a next packet.
+   * @return false if no packet was received.
+   */
+  virtual bool Receive(TransportPacket& packet) = 0;
+
+  /**
+   * @brief Sends the queued packets, receives the new ones and sends again
+   * the reliable packets that are not acknowledged, called once per update.
+   */
+  virtual void Service() = 0;
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "transport.h"
+
+/**
+ * @brief The counters of a UdpTransport, to compare the number of system
+ * calls with the number of datagrams.
+ */
+struct UdpTransportStats {
+  long long sent_datagrams = 0;
+  long long received_datagrams = 0;
+  long long send_calls = 0;
+  long long receive_calls = 0;
+  // The reliable packets sent again because they were not acknowledged.
+  long long resent_packets = 0;
+  // The packets too large for a datagram or sent to an unknown peer.
+  long long dropped_packets = 0;
+  // The received datagrams dropped on purpose, see UdpTransport::SetLossRate.
+  long long lost_datagrams = 0;
+};
+
+/**
+ * @brief A transport over a native non-blocking UDP socket, Linux only.
+ *
+ * The datagrams are sent and received by batches with sendmmsg and recvmmsg,
+ * one system call for up to kBatchSize datagrams. The reliable packets are
+ * numbered for each peer, acknowledged with the number of the next expected
+ * one and a bitmask of the ones received after it, sent again after
+ * kResendDelay until they are, and delivered in order.
+ * At most kSendWindow of them are in flight, the next ones wait for the
+ * acknowledgments so a burst does not overflow the buffers of the receiver.
+ */
+class UdpTransport final : public Transport {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Below the usual MTU, a datagram is never fragmented.
+  static constexpr std::size_t kMaxDatagramSize = 1200;
+  static constexpr int kBatchSize = 32;
+  static constexpr Clock::duration kResendDelay =
+      std::chrono::milliseconds(100);
+  // The reliable packets received ahead of a missing one that are kept.
+  static constexpr std::size_t kMaxOutOfOrderPackets = 256;
+  // The receiver keeps every packet in flight after a lost one.
+  static constexpr std::size_t kSendWindow = kMaxOutOfOrderPackets;
+
+  UdpTransport() = default;
+  ~UdpTransport() override { Close(); }
+
+  UdpTransport(const UdpTransport&) = delete;
+  UdpTransport& operator=(const UdpTransport&) = delete;
+
+  /**
+   * @brief Opens a non-blocking socket bound to a local port.
+   * @param port The local port, 0 to let the system choose one.
+   * @return false if the socket could not be opened or bound.
+   */
+  bool Open(std::uint16_t port);
+
+  void Close() noexcept;
+
+  [[nodiscard]] bool IsOpen() const noexcept { return socket_ != -1; }
+
+  /**
+   * @brief Gets the local port of the open socket, 0 if it is not open.
+   */
+  [[nodiscard]] std::uint16_t GetLocalPort() const noexcept;
+
+  /**
+   * @brief Sets the address of a peer, the packets from another address are
+   * ignored.
+   * @param host An IPv4 address like "127.0.0.1".
+   * @param first_sequence The number of the first reliable packet, in both
+   * directions, so both peers must set the same. The tests start close to
+   * the wraparound of the numbers.
+   * @return false if the address is not valid.
+   */
+  bool SetPeer(int peer, const char* host, std::uint16_t port,
+               std::uint32_t first_sequence = 0);
+
+  /**
+   * @brief Sets the probability for a received datagram to be dropped,
+   * between 0 and 1, to test the resends under packet loss on localhost.
+   * The acknowledgments can be lost too.
+   */
+  void SetLossRate(float loss_rate) noexcept { loss_rate_ = loss_rate; }
+
+  void SendUnreliable(int peer, const std::uint8_t* data,
+                      std::size_t size) override;
+  void SendReliable(int peer, const std::uint8_t* data,
+                    std::size_t size) override;
+  bool Receive(TransportPacket& packet) override;
+  void Service() override;
+
+  [[nodiscard]] const UdpTransportStats& GetStats() const noexcept {
+    return stats_;
+  }
+
+ private:
+  enum class DatagramType : std::uint8_t { kUnreliable = 0, kReliable, kAck };
+
+  // The type, then the number of a reliable packet or of an acknowledgment.
+  static constexpr std::size_t kHeaderSize = 5;
+  // An acknowledgment is followed by one bit for each packet after the next
+  // expected one, set if it was received out of order.
+  static constexpr std::size_t kAckMaskSize = kMaxOutOfOrderPackets / 8;
+
+  struct Datagram {
+    int peer = -1;
+    std::vector<std::uint8_t> data{};
+  };
+
+  struct PendingPacket {
+    std::uint32_t sequence = 0;
+    std::vector<std::uint8_t> datagram{};
+    bool is_sent = false;
+    // Received out of order, it is not sent again but stays in the window
+    // until the packets before it are received.
+    bool is_acked = false;
+    Clock::time_point last_send_time{};
+  };
+
+  struct Peer {
+    sockaddr_in address{};
+    bool is_set = false;
+
+    std::uint32_t next_send_sequence = 0;
+    std::deque<PendingPacket> unacked_packets{};
+
+    std::uint32_t next_receive_sequence = 0;
+    std::map<std::uint32_t, std::vector<std::uint8_t>> out_of_order_packets{};
+    bool must_ack = false;
+  };
+
+  int socket_ = -1;
+  std::vector<Peer> peers_{};
+
+  // The datagrams sent at the next Service, their buffers are reused.
+  std::vector<Datagram> send_queue_{};
+  std::size_t send_count_ = 0;
+
+  std::deque<TransportPacket> received_packets_{};
+  // The buffers given back by Receive, reused for the next packets.
+  std::vector<std::vector<std::uint8_t>> free_buffers_{};
+
+  std::array<std::array<std::uint8_t, kMaxDatagramSize>, kBatchSize>
+      receive_buffers_{};
+  std::array<std::uint8_t, kAckMaskSize> ack_mask_{};
+
+  UdpTransportStats stats_{};
+
+  float loss_rate_ = 0.f;
+  std::mt19937 random_engine_{};
+
+  [[nodiscard]] bool IsPeer(int peer) const noexcept {
+    return peer >= 0 && peer < static_cast<int>(peers_.size()) &&
+           peers_[peer].is_set;
+  }
+
+  /**
+   * @brief Calls a function with each peer a packet is sent to.
+   */
+  template <typename TFunction>
+  void ForEachReceiver(int peer, TFunction&& function) {
+    if (peer != kAllPeers) {
+      if (IsPeer(peer)) {
+        function(peer);
+      } else {
+        stats_.dropped_packets++;
+      }
+      return;
+    }
+    for (int other = 0; other < static_cast<int>(peers_.size()); other++) {
+      if (peers_[other].is_set) {
+        function(other);
+      }
+    }
+  }
+
+  void QueueDatagram(int peer, DatagramType type, std::uint32_t sequence,
+                     const std::uint8_t* data, std::size_t size);
+  void QueueDatagram(int peer, const std::vector<std::uint8_t>& datagram);
+
+  void ReceiveDatagrams();
+  void HandleDatagram(int peer, const std::uint8_t* data, std::size_t size);
+  void HandleReliable(int peer, std::uint32_t sequence,
+                      const std::uint8_t* data, std::size_t size);
+  void HandleAck(int peer, std::uint32_t next_sequence,
+                 const std::uint8_t* mask, std::size_t mask_size) noexcept;
+  void AddReceivedPacket(int peer, const std::uint8_t* data, std::size_t size);
+
+  void QueueAcks();
+  void QueueResends(Clock::time_point now);
+  void SendDatagrams();
+
+  [[nodiscard]] int FindPeer(const sockaddr_in& address) const noexcept;
+};
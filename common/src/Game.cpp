@@ -1,81 +1,62 @@
 #include "Game.h"
 
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+#include "checksum.h"
+
 #ifdef TRACY_ENABLE
 #include <TracyC.h>
 
 #include <Tracy.hpp>
 #endif
 
+namespace {
+
+// Only the first bodies have a bit in a BodyMask.
+bool HasMaskBit(std::size_t body_index) noexcept {
+  return body_index < std::numeric_limits<BodyMask>::digits;
+}
+
+}  // namespace
+
 void Game::ProcessInput() noexcept {
 #ifdef TRACY_ENABLE
   ZoneScoped;
 #endif
-  if (player_nbr == 0) {
-    if (input_ & input::kRight)  // player moves right
-    {
-      world_.GetBody(player_blue_body_ref_).ApplyForce({kWalkSpeed, 0});
-    }
-    if (input_ & input::kLeft)  // player moves left
-    {
-      world_.GetBody(player_blue_body_ref_).ApplyForce({-kWalkSpeed, 0});
-    }
-    if ((input_ & input::kJump) && is_player_blue_grounded_)  // player jumps
-    {
-      world_.GetBody(player_blue_body_ref_).ApplyForce({0, kJumpSpeed});
-      is_player_blue_grounded_ = false;
-    }
-    if ((input_ & input::kKick) && can_player_blue_kick_ &&
-        player_blue_kick_time_ >= 1.0f)  // player kicks the ball
-    {
-      world_.GetBody(ball_body_ref_).ApplyForce({kShootForce, -kShootForce});
-      player_blue_kick_time_ = 0.f;
-    }
-    if (other_player_input_ & input::kRight) {
-      world_.GetBody(player_red_body_ref_).ApplyForce({kWalkSpeed, 0});
-    }
-    if (other_player_input_ & input::kLeft) {
-      world_.GetBody(player_red_body_ref_).ApplyForce({-kWalkSpeed, 0});
-    }
-    if ((other_player_input_ & input::kJump) && is_player_red_grounded_) {
-      world_.GetBody(player_red_body_ref_).ApplyForce({0, kJumpSpeed});
-      is_player_red_grounded_ = false;
-    }
-    if ((other_player_input_ & input::kKick) && can_player_red_kick_ &&
-        player_red_kick_time_ >= 1.0f) {
-      world_.GetBody(ball_body_ref_).ApplyForce({-kShootForce, -kShootForce});
-      player_red_kick_time_ = 0.f;
-    }
-  } else {
-    if (input_ & input::kRight) {
-      world_.GetBody(player_red_body_ref_).ApplyForce({kWalkSpeed, 0});
-    }
-    if (input_ & input::kLeft) {
-      world_.GetBody(player_red_body_ref_).ApplyForce({-kWalkSpeed, 0});
-    }
-    if ((input_ & input::kJump) && is_player_red_grounded_) {
-      world_.GetBody(player_red_body_ref_).ApplyForce({0, kJumpSpeed});
-      is_player_red_grounded_ = false;
-    }
-    if ((input_ & input::kKick) && can_player_red_kick_ &&
-        player_red_kick_time_ >= 1.0f) {
-      world_.GetBody(ball_body_ref_).ApplyForce({-kShootForce, -kShootForce});
-      player_red_kick_time_ = 0.f;
-    }
-    if (other_player_input_ & input::kRight) {
-      world_.GetBody(player_blue_body_ref_).ApplyForce({kWalkSpeed, 0});
-    }
-    if (other_player_input_ & input::kLeft) {
-      world_.GetBody(player_blue_body_ref_).ApplyForce({-kWalkSpeed, 0});
-    }
-    if ((other_player_input_ & input::kJump) && is_player_blue_grounded_) {
-      world_.GetBody(player_blue_body_ref_).ApplyForce({0, kJumpSpeed});
-      is_player_blue_grounded_ = false;
-    }
-    if ((other_player_input_ & input::kKick) && can_player_blue_kick_ &&
-        player_blue_kick_time_ >= 1.0f) {
-      world_.GetBody(ball_body_ref_).ApplyForce({kShootForce, -kShootForce});
-      player_blue_kick_time_ = 0.f;
-    }
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    ProcessPlayerInput(player_id);
+  }
+}
+
+void Game::ProcessPlayerInput(int player_id) noexcept {
+  auto& player = gameplay_.players[player_id];
+  auto& player_body = world_.GetBody(player.body_ref);
+
+  // The blue team kicks to the right and the red team to the left.
+  const float kick_direction =
+      GetPlayerTeam(player_id) == Team::kBlue ? 1.f : -1.f;
+
+  if (player.input & input::kRight)  // player moves right
+  {
+    player_body.ApplyForce({kWalkSpeed, 0});
+  }
+  if (player.input & input::kLeft)  // player moves left
+  {
+    player_body.ApplyForce({-kWalkSpeed, 0});
+  }
+  if ((player.input & input::kJump) && player.is_grounded)  // player jumps
+  {
+    player_body.ApplyForce({0, kJumpSpeed});
+    player.is_grounded = false;
+  }
+  if ((player.input & input::kKick) && player.can_kick &&
+      player.kick_time >= 1.0f)  // player kicks the ball
+  {
+    world_.GetBody(gameplay_.ball_body_ref)
+        .ApplyForce({kick_direction * kShootForce, -kShootForce});
+    player.kick_time = 0.f;
   }
 }
 
@@ -99,76 +80,29 @@ void Game::FixedUpdate() noexcept {
   ZoneScoped;
 #endif
 
-  switch (state_) {
+  switch (gameplay_.state) {
     case GameState::kMenu:
       break;
     case GameState::kInGame:
+      ClearInteractions();
       world_.Update(metrics::kFixedDeltaTime);
-      player_blue_kick_time_ += metrics::kFixedDeltaTime;
-      player_red_kick_time_ += metrics::kFixedDeltaTime;
+      AddTriggerInteractions();
+
+      for (int player_id = 0; player_id < gameplay_.player_count;
+           player_id++) {
+        gameplay_.players[player_id].kick_time += metrics::kFixedDeltaTime;
+      }
 
       ProcessInput();
 
-      for (std::size_t i = 0; i < col_refs_.size(); ++i) {
-        const auto& col = world_.GetCollider(col_refs_[i]);
-
-        const auto& shape = world_.GetCollider(col_refs_[i]).Shape;
-
-        if (col.BodyRef == ball_body_ref_) {
-          auto& ballBody = world_.GetBody(col.BodyRef);
-          ballBody.ApplyForce({0, kBallGravity});
-
-        } else if (col.BodyRef == player_blue_body_ref_) {
-          auto& playerBody = world_.GetBody(col.BodyRef);
-
-          if (playerBody.Velocity.X > kMaxSpeed) {
-            playerBody.Velocity.X = kMaxSpeed;
-          } else if (playerBody.Velocity.X < -kMaxSpeed) {
-            playerBody.Velocity.X = -kMaxSpeed;
-          }
-          playerBody.ApplyForce({0, kPlayerGravity});
-
-          // simulate friction with fground
-          if (player_nbr == 0) {
-            if (!(input_ & input::kRight) && !(input_ & input::kLeft) &&
-                is_player_blue_grounded_) {
-              playerBody.Velocity =
-                  playerBody.Velocity.Lerp(Math::Vec2F::Zero(), 1.f / 10.f);
-            }
-          } else {
-            if (!(other_player_input_ & input::kRight) &&
-                !(other_player_input_ & input::kLeft) &&
-                is_player_blue_grounded_) {
-              playerBody.Velocity =
-                  playerBody.Velocity.Lerp(Math::Vec2F::Zero(), 1.f / 10.f);
-            }
-          }
-        } else if (col.BodyRef == player_red_body_ref_) {
-          auto& playerBody = world_.GetBody(col.BodyRef);
-
-          if (playerBody.Velocity.X > kMaxSpeed) {
-            playerBody.Velocity.X = kMaxSpeed;
-          } else if (playerBody.Velocity.X < -kMaxSpeed) {
-            playerBody.Velocity.X = -kMaxSpeed;
-          }
-          playerBody.ApplyForce({0, kPlayerGravity});
-
-          // simulate friction with ground
-          if (player_nbr == 1) {
-            if (!(input_ & input::kRight) && !(input_ & input::kLeft) &&
-                is_player_red_grounded_) {
-              playerBody.Velocity =
-                  playerBody.Velocity.Lerp(Math::Vec2F::Zero(), 1.f / 10.f);
-            }
-          } else {
-            if (!(other_player_input_ & input::kRight) &&
-                !(other_player_input_ & input::kLeft) &&
-                is_player_red_grounded_) {
-              playerBody.Velocity =
-                  playerBody.Velocity.Lerp(Math::Vec2F::Zero(), 1.f / 10.f);
-            }
-          }
-        }
+      world_.GetBody(gameplay_.ball_body_ref).ApplyForce({0, kBallGravity});
+
+      for (int player_id = 0; player_id < gameplay_.player_count;
+           player_id++) {
+        // The player physics is applied once per player collider (body and
+        // feet), the movement constants are tuned for it.
+        ApplyPlayerPhysics(gameplay_.players[player_id]);
+        ApplyPlayerPhysics(gameplay_.players[player_id]);
       }
       break;
     case GameState::kGameFinished:
@@ -178,107 +112,270 @@ void Game::FixedUpdate() noexcept {
   }
 }
 
+bool Game::FixedUpdateIsland(BodyMask island, const Game& outside) noexcept {
+#ifdef TRACY_ENABLE
+  ZoneScoped;
+#endif
+  if (gameplay_.state != GameState::kInGame) {
+    FixedUpdate();
+    return true;
+  }
+
+  const auto team_scores = gameplay_.team_scores;
+
+  ClearInteractions();
+  if (!world_.UpdateIsland(metrics::kFixedDeltaTime, island, outside.world_)) {
+    return false;
+  }
+  AddTriggerInteractions();
+
+  // A goal puts every body back to its spawn position.
+  if (gameplay_.team_scores != team_scores ||
+      gameplay_.has_global_interaction) {
+    return false;
+  }
+
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    if ((GetPlayerBodyMask(player_id) & island) != 0) {
+      gameplay_.players[player_id].kick_time += metrics::kFixedDeltaTime;
+    }
+  }
+
+  // The players of the island cannot overlap a ball outside of it, so they
+  // can only kick a ball of the island.
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    if ((GetPlayerBodyMask(player_id) & island) != 0) {
+      ProcessPlayerInput(player_id);
+    }
+  }
+
+  if (World::IsInIsland(gameplay_.ball_body_ref.Index, island)) {
+    world_.GetBody(gameplay_.ball_body_ref).ApplyForce({0, kBallGravity});
+  }
+
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    if ((GetPlayerBodyMask(player_id) & island) != 0) {
+      ApplyPlayerPhysics(gameplay_.players[player_id]);
+      ApplyPlayerPhysics(gameplay_.players[player_id]);
+    }
+  }
+  return true;
+}
+
+void Game::CopyOutsideIsland(const Game& other, BodyMask island) noexcept {
+  world_.CopyOutsideIsland(other.world_, island);
+
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    if ((GetPlayerBodyMask(player_id) & island) == 0) {
+      gameplay_.players[player_id] = other.gameplay_.players[player_id];
+    }
+  }
+
+  // The groups of the island come from this state and the other groups from
+  // the other state, a group is never on both sides.
+  auto groups = gameplay_.interaction_groups;
+  int group_count = 0;
+  for (int index = 0; index < gameplay_.interaction_group_count; index++) {
+    if ((gameplay_.interaction_groups[index] & island) != 0) {
+      groups[group_count++] = gameplay_.interaction_groups[index];
+    }
+  }
+  for (int index = 0; index < other.gameplay_.interaction_group_count;
+       index++) {
+    const auto group = other.gameplay_.interaction_groups[index];
+    if ((group & island) != 0) {
+      continue;
+    }
+    if (group_count == GameplayState::kMaxInteractionGroupNbr) {
+      gameplay_.has_global_interaction = true;
+      break;
+    }
+    groups[group_count++] = group;
+  }
+  gameplay_.interaction_groups = groups;
+  gameplay_.interaction_group_count = group_count;
+  gameplay_.has_global_interaction |= other.gameplay_.has_global_interaction;
+}
+
+void Game::ApplyPlayerPhysics(const Player& player) noexcept {
+  auto& playerBody = world_.GetBody(player.body_ref);
+
+  if (playerBody.Velocity.X > kMaxSpeed) {
+    playerBody.Velocity.X = kMaxSpeed;
+  } else if (playerBody.Velocity.X < -kMaxSpeed) {
+    playerBody.Velocity.X = -kMaxSpeed;
+  }
+  playerBody.ApplyForce({0, kPlayerGravity});
+
+  // simulate friction with ground
+  if (!(player.input & input::kRight) && !(player.input & input::kLeft) &&
+      player.is_grounded) {
+    playerBody.Velocity =
+        playerBody.Velocity.Lerp(Math::Vec2F::Zero(), 1.f / 10.f);
+  }
+}
+
+void Game::ClearInteractions() noexcept {
+  gameplay_.interaction_group_count = 0;
+  gameplay_.has_global_interaction = false;
+}
+
+void Game::AddInteraction(const BodyRef& body_ref_a,
+                          const BodyRef& body_ref_b) noexcept {
+  const auto& bodies = world_.GetBodies();
+  if (body_ref_a == body_ref_b ||
+      bodies[body_ref_a.Index].Type == BodyType::STATIC ||
+      bodies[body_ref_b.Index].Type == BodyType::STATIC) {
+    return;
+  }
+  if (!HasMaskBit(body_ref_a.Index) ||
+      !HasMaskBit(body_ref_b.Index)) {
+    gameplay_.has_global_interaction = true;
+    return;
+  }
+
+  // The groups that contain one of the bodies are merged into one.
+  BodyMask merged_group =
+      (BodyMask{1} << body_ref_a.Index) | (BodyMask{1} << body_ref_b.Index);
+  int group_count = 0;
+  for (int index = 0; index < gameplay_.interaction_group_count; index++) {
+    const auto group = gameplay_.interaction_groups[index];
+    if ((group & merged_group) != 0) {
+      merged_group |= group;
+    } else {
+      gameplay_.interaction_groups[group_count++] = group;
+    }
+  }
+  if (group_count == GameplayState::kMaxInteractionGroupNbr) {
+    gameplay_.has_global_interaction = true;
+    return;
+  }
+  gameplay_.interaction_groups[group_count++] = merged_group;
+  gameplay_.interaction_group_count = group_count;
+}
+
+void Game::AddTriggerInteractions() noexcept {
+  const auto& colliders = world_.GetColliders();
+  for (const auto& pair : world_.GetColliderRefPairs()) {
+    AddInteraction(colliders[pair.ColRefA.Index].BodyRef,
+                   colliders[pair.ColRefB.Index].BodyRef);
+  }
+}
+
+BodyMask Game::GetPlayerBodyMask(int player_id) const noexcept {
+  const auto body_index = gameplay_.players[player_id].body_ref.Index;
+  return HasMaskBit(body_index) ? BodyMask{1} << body_index : 0;
+}
+
+BodyMask Game::GetDynamicBodyMask() const noexcept {
+  BodyMask bodies = 0;
+  const auto ball_index = gameplay_.ball_body_ref.Index;
+  if (HasMaskBit(ball_index)) {
+    bodies |= BodyMask{1} << ball_index;
+  }
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    bodies |= GetPlayerBodyMask(player_id);
+  }
+  return bodies;
+}
+
+BodyMask Game::AddInteractingBodies(BodyMask bodies) const noexcept {
+  if (gameplay_.has_global_interaction) {
+    return ~BodyMask{0};
+  }
+  // The groups are disjoint, one pass finds every group of the bodies.
+  BodyMask interacting_bodies = bodies;
+  for (int index = 0; index < gameplay_.interaction_group_count; index++) {
+    if ((gameplay_.interaction_groups[index] & bodies) != 0) {
+      interacting_bodies |= gameplay_.interaction_groups[index];
+    }
+  }
+  return interacting_bodies;
+}
+
 void Game::TearDown() noexcept {
   player_nbr = -1;
-  body_refs_.clear();
-  col_refs_.clear();
   world_.TearDown();
 }
 
 void Game::StartGame() {
   Setup();
-  state_ = GameState::kInGame;
+  gameplay_.state = GameState::kInGame;
 }
 
-GameState Game::GetState() { return state_; }
+GameState Game::GetState() { return gameplay_.state; }
 
 void Game::Copy(const Game& other) {
   world_ = other.world_;
   world_.SetContactListener(this);
+  world_.SetLightweight(is_resimulating_);
 
-  input_ = other.input_;
-  other_player_input_ = other.other_player_input_;
-
-  player_blue_kick_time_ = other.player_blue_kick_time_;
-  player_red_kick_time_ = other.player_red_kick_time_;
-
-  can_player_blue_kick_ = other.can_player_blue_kick_;
-  can_player_red_kick_ = other.can_player_red_kick_;
-
-  is_player_blue_grounded_ = other.is_player_blue_grounded_;
-  is_player_red_grounded_ = other.is_player_red_grounded_;
-
-  blue_score_ = other.blue_score_;
-  red_score_ = other.red_score_;
+  gameplay_ = other.gameplay_;
 }
 
-float Game::GetBallRadius() const noexcept { return ball_radius_; }
+float Game::GetBallRadius() const noexcept { return gameplay_.ball_radius; }
 
 Math::Vec2F Game::GetBallPosition() noexcept {
-  return world_.GetBody(ball_body_ref_).Position;
+  return world_.GetBody(gameplay_.ball_body_ref).Position;
 }
 
 Math::Vec2F Game::GetBallVelocity() noexcept {
-  return world_.GetBody(ball_body_ref_).Velocity;
+  return world_.GetBody(gameplay_.ball_body_ref).Velocity;
 }
 
-BallType Game::GetBallType() noexcept { return ball_type_; }
+BallType Game::GetBallType() noexcept { return gameplay_.ball_type; }
 
-Math::Vec2F Game::GetPlayerBluePos() noexcept {
-  return world_.GetBody(player_blue_body_ref_).Position;
+Math::Vec2F Game::GetPlayerPos(int player_id) noexcept {
+  return world_.GetBody(gameplay_.players[player_id].body_ref).Position;
 }
-Math::Vec2F Game::GetPlayerRedPos() noexcept {
-  return world_.GetBody(player_red_body_ref_).Position;
-}
-
-void Game::SetPlayerInput(input::Input input) noexcept { input_ = input; }
 
-void Game::SetOtherPlayerInput(input::Input input) noexcept {
-  other_player_input_ = input;
+void Game::SetPlayerInput(int player_id, input::Input input) noexcept {
+  gameplay_.players[player_id].input = input;
 }
 
-void Game::EndGame() { state_ = GameState::kGameFinished; }
+void Game::EndGame() { gameplay_.state = GameState::kGameFinished; }
 
 void Game::Restart() {
-  state_ = GameState::kMenu;
-
-  input_ = 0;
-  other_player_input_ = 0;
-
-  blue_score_ = 0;
-  red_score_ = 0;
+  // The player count and the ball type are chosen before the game starts,
+  // they are kept for the next game.
+  GameplayState gameplay{};
+  gameplay.player_count = gameplay_.player_count;
+  gameplay.ball_type = gameplay_.ball_type;
+  gameplay_ = gameplay;
   TearDown();
 }
 
 void Game::OnTriggerEnter(ColliderRef col1, ColliderRef col2) noexcept {
-  if ((col1 == player_blue_feet_col_ref_ && col2 == ball_col_ref_) ||
-      (col2 == player_blue_feet_col_ref_ && col1 == ball_col_ref_)) {
-    can_player_blue_kick_ = true;
-  }
-  if ((col1 == player_red_feet_col_ref_ && col2 == ball_col_ref_) ||
-      (col2 == player_red_feet_col_ref_ && col1 == ball_col_ref_)) {
-    can_player_red_kick_ = true;
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    auto& player = gameplay_.players[player_id];
+    if ((col1 == player.feet_col_ref && col2 == gameplay_.ball_col_ref) ||
+        (col2 == player.feet_col_ref && col1 == gameplay_.ball_col_ref)) {
+      player.can_kick = true;
+    }
   }
-  if ((col1 == left_goal_col_ref_ && col2 == ball_col_ref_) ||
-      (col2 == left_goal_col_ref_ && col1 == ball_col_ref_)) {
-    red_score_ += 1;
+  if ((col1 == gameplay_.left_goal_col_ref &&
+       col2 == gameplay_.ball_col_ref) ||
+      (col2 == gameplay_.left_goal_col_ref &&
+       col1 == gameplay_.ball_col_ref)) {
+    gameplay_.team_scores[static_cast<int>(Team::kRed)] += 1;
     ResetPositions();
   }
-  if ((col1 == right_goal_col_ref_ && col2 == ball_col_ref_) ||
-      (col2 == right_goal_col_ref_ && col1 == ball_col_ref_)) {
-    blue_score_ += 1;
+  if ((col1 == gameplay_.right_goal_col_ref &&
+       col2 == gameplay_.ball_col_ref) ||
+      (col2 == gameplay_.right_goal_col_ref &&
+       col1 == gameplay_.ball_col_ref)) {
+    gameplay_.team_scores[static_cast<int>(Team::kBlue)] += 1;
     ResetPositions();
   }
 }
 
 void Game::OnTriggerExit(ColliderRef col1, ColliderRef col2) noexcept {
-  if ((col1 == player_blue_feet_col_ref_ && col2 == ball_col_ref_) ||
-      (col2 == player_blue_feet_col_ref_ && col1 == ball_col_ref_)) {
-    can_player_blue_kick_ = false;
-  }
-  if ((col1 == player_red_feet_col_ref_ && col2 == ball_col_ref_) ||
-      (col2 == player_red_feet_col_ref_ && col1 == ball_col_ref_)) {
-    can_player_red_kick_ = false;
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    auto& player = gameplay_.players[player_id];
+    if ((col1 == player.feet_col_ref && col2 == gameplay_.ball_col_ref) ||
+        (col2 == player.feet_col_ref && col1 == gameplay_.ball_col_ref)) {
+      player.can_kick = false;
+    }
   }
 }
 
@@ -286,88 +383,331 @@ void Game::OnCollisionEnter(ColliderRef col1, ColliderRef col2) noexcept {
 #ifdef TRACY_ENABLE
   ZoneScoped;
 #endif
-  if ((col1 == player_blue_col_ref_ && col2 == ground_col_ref_) ||
-      (col2 == player_blue_col_ref_ && col1 == ground_col_ref_)) {
-    is_player_blue_grounded_ = true;
-  } else if ((col1 == player_red_col_ref_ && col2 == ground_col_ref_) ||
-             (col2 == player_red_col_ref_ && col1 == ground_col_ref_)) {
-    is_player_red_grounded_ = true;
+  AddInteraction(world_.GetCollider(col1).BodyRef,
+                 world_.GetCollider(col2).BodyRef);
+
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    auto& player = gameplay_.players[player_id];
+    if ((col1 == player.col_ref && col2 == gameplay_.ground_col_ref) ||
+        (col2 == player.col_ref && col1 == gameplay_.ground_col_ref)) {
+      player.is_grounded = true;
+      return;
+    }
   }
 }
 
 int Game::CheckSum() noexcept {
-  auto p1Pos = world_.GetBody(player_blue_body_ref_).Position;
-  auto p1Vel = world_.GetBody(player_blue_body_ref_).Velocity;
+#ifdef TRACY_ENABLE
+  ZoneScoped;
+#endif
+  const auto structure_version = world_.GetStructureVersion();
+  if (!is_checksum_incremental_ || !has_static_checksum_ ||
+      static_checksum_version_ != structure_version) {
+    state_writer_.Clear();
+    SerializeStaticRegion(state_writer_);
+    static_checksum_ =
+        checksum::Crc32c(state_writer_.GetData(), state_writer_.GetSize());
+    static_checksum_version_ = structure_version;
+    has_static_checksum_ = true;
+  }
+
+  // Continue the crc of the static region, the result is the crc of both
+  // regions one after the other.
+  state_writer_.Clear();
+  SerializeDynamicRegion(state_writer_);
+  const auto checksum = checksum::Crc32c(
+      state_writer_.GetData(), state_writer_.GetSize(), static_checksum_);
+
+  return static_cast<int>(checksum);
+}
+
+bool Game::IsStaticCollider(const Collider& collider) const noexcept {
+  if (!collider.IsAttached) {
+    return false;
+  }
+  const auto& body = world_.GetBodies()[collider.BodyRef.Index];
+  return body.IsEnabled() && body.Type == BodyType::STATIC;
+}
+
+void Game::SerializeStaticRegion(StateWriter& writer) const {
+  const auto& bodies = world_.GetBodies();
+  const auto& colliders = world_.GetColliders();
+
+  writer.WriteU32(static_cast<std::uint32_t>(bodies.size()));
+  writer.WriteU32(static_cast<std::uint32_t>(colliders.size()));
+
+  for (const auto gen_index : world_.BodyGenIndices) {
+    writer.WriteU32(static_cast<std::uint32_t>(gen_index));
+  }
+  for (const auto gen_index : world_.ColliderGenIndices) {
+    writer.WriteU32(static_cast<std::uint32_t>(gen_index));
+  }
+
+  for (std::size_t index = 0; index < bodies.size(); index++) {
+    if (bodies[index].IsEnabled() && bodies[index].Type == BodyType::STATIC) {
+      writer.WriteU32(static_cast<std::uint32_t>(index));
+      writer.WriteBody(bodies[index]);
+    }
+  }
 
-  auto p2Pos = world_.GetBody(player_red_body_ref_).Position;
-  auto p2Vel = world_.GetBody(player_red_body_ref_).Velocity;
+  for (std::size_t index = 0; index < colliders.size(); index++) {
+    if (IsStaticCollider(colliders[index])) {
+      writer.WriteU32(static_cast<std::uint32_t>(index));
+      writer.WriteCollider(colliders[index]);
+    }
+  }
+}
 
-  auto ballPos = world_.GetBody(ball_body_ref_).Position;
-  auto ballVel = world_.GetBody(ball_body_ref_).Velocity;
+void Game::SerializeDynamicRegion(StateWriter& writer) const {
+  const auto& bodies = world_.GetBodies();
+  const auto& colliders = world_.GetColliders();
+
+  for (std::size_t index = 0; index < bodies.size(); index++) {
+    if (!bodies[index].IsEnabled() || bodies[index].Type != BodyType::STATIC) {
+      writer.WriteU32(static_cast<std::uint32_t>(index));
+      writer.WriteBody(bodies[index]);
+    }
+  }
+
+  for (std::size_t index = 0; index < colliders.size(); index++) {
+    if (!IsStaticCollider(colliders[index])) {
+      writer.WriteU32(static_cast<std::uint32_t>(index));
+      writer.WriteCollider(colliders[index]);
+    }
+  }
 
-  return *reinterpret_cast<int*>(&p1Pos.X) + *reinterpret_cast<int*>(&p1Pos.Y) +
-         *reinterpret_cast<int*>(&p1Vel.X) + *reinterpret_cast<int*>(&p1Vel.Y) +
-         *reinterpret_cast<int*>(&p2Pos.X) + *reinterpret_cast<int*>(&p2Pos.Y) +
-         *reinterpret_cast<int*>(&p2Vel.X) + *reinterpret_cast<int*>(&p2Vel.Y) +
-         *reinterpret_cast<int*>(&ballPos.X) +
-         *reinterpret_cast<int*>(&ballPos.Y) +
-         *reinterpret_cast<int*>(&ballVel.X) +
-         *reinterpret_cast<int*>(&ballVel.Y);
+  SerializeContacts(writer);
+
+  writer.WriteInt(gameplay_.player_count);
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    SerializePlayer(writer, player_id);
+  }
+
+  SerializeScores(writer);
+}
+
+void Game::SerializeContacts(StateWriter& writer) const {
+  // The iteration order of the set depends on its history, sort the pairs.
+  const auto& pair_set = world_.GetColliderRefPairs();
+  std::vector<ColliderRefPair> pairs(pair_set.begin(), pair_set.end());
+  std::sort(pairs.begin(), pairs.end(),
+            [](const ColliderRefPair& lhs, const ColliderRefPair& rhs) {
+              return std::tie(lhs.ColRefA.Index, lhs.ColRefA.GenIndex,
+                              lhs.ColRefB.Index, lhs.ColRefB.GenIndex) <
+                     std::tie(rhs.ColRefA.Index, rhs.ColRefA.GenIndex,
+                              rhs.ColRefB.Index, rhs.ColRefB.GenIndex);
+            });
+  writer.WriteU32(static_cast<std::uint32_t>(pairs.size()));
+  for (const auto& pair : pairs) {
+    writer.WriteU32(static_cast<std::uint32_t>(pair.ColRefA.Index));
+    writer.WriteU32(static_cast<std::uint32_t>(pair.ColRefA.GenIndex));
+    writer.WriteU32(static_cast<std::uint32_t>(pair.ColRefB.Index));
+    writer.WriteU32(static_cast<std::uint32_t>(pair.ColRefB.GenIndex));
+  }
+}
+
+void Game::SerializePlayer(StateWriter& writer, int player_id) const {
+  const auto& player = gameplay_.players[player_id];
+  writer.WriteU8(player.input);
+  writer.WriteBool(player.is_grounded);
+  writer.WriteFloat(player.kick_time);
+  writer.WriteBool(player.can_kick);
+}
+
+void Game::SerializeScores(StateWriter& writer) const {
+  for (const auto score : gameplay_.team_scores) {
+    writer.WriteInt(score);
+  }
+}
+
+void Game::Serialize(StateWriter& writer) const {
+  const auto& bodies = world_.GetBodies();
+  writer.WriteU32(static_cast<std::uint32_t>(bodies.size()));
+  for (std::size_t index = 0; index < bodies.size(); index++) {
+    writer.WriteU32(static_cast<std::uint32_t>(world_.BodyGenIndices[index]));
+    writer.WriteBody(bodies[index]);
+  }
+
+  const auto& colliders = world_.GetColliders();
+  writer.WriteU32(static_cast<std::uint32_t>(colliders.size()));
+  for (std::size_t index = 0; index < colliders.size(); index++) {
+    writer.WriteU32(
+        static_cast<std::uint32_t>(world_.ColliderGenIndices[index]));
+    writer.WriteCollider(colliders[index]);
+  }
+
+  SerializeContacts(writer);
+
+  writer.WriteInt(gameplay_.player_count);
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    SerializePlayer(writer, player_id);
+  }
+
+  SerializeScores(writer);
+}
+
+bool Game::Deserialize(StateReader& reader) {
+  // Every body and collider takes at least 4 bytes, a larger count is not
+  // read to not allocate too much memory for corrupted data.
+  const auto body_count = reader.ReadU32();
+  if (body_count > reader.GetRemainingSize() / 4) {
+    return false;
+  }
+  std::vector<Body> bodies(body_count);
+  std::vector<std::size_t> body_gen_indices(body_count);
+  for (std::uint32_t index = 0; index < body_count; index++) {
+    body_gen_indices[index] = reader.ReadU32();
+    bodies[index] = reader.ReadBody();
+  }
+
+  const auto collider_count = reader.ReadU32();
+  if (collider_count > reader.GetRemainingSize() / 4) {
+    return false;
+  }
+  std::vector<Collider> colliders(collider_count);
+  std::vector<std::size_t> collider_gen_indices(collider_count);
+  for (std::uint32_t index = 0; index < collider_count; index++) {
+    collider_gen_indices[index] = reader.ReadU32();
+    colliders[index] = reader.ReadCollider();
+  }
+
+  const auto pair_count = reader.ReadU32();
+  if (pair_count > reader.GetRemainingSize() / 16) {
+    return false;
+  }
+  std::vector<ColliderRefPair> pairs(pair_count);
+  for (auto& pair : pairs) {
+    pair.ColRefA.Index = reader.ReadU32();
+    pair.ColRefA.GenIndex = reader.ReadU32();
+    pair.ColRefB.Index = reader.ReadU32();
+    pair.ColRefB.GenIndex = reader.ReadU32();
+  }
+
+  // The references of the players are created by StartGame, only their state
+  // is read.
+  if (reader.ReadInt() != gameplay_.player_count) {
+    return false;
+  }
+  auto players = gameplay_.players;
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    auto& player = players[player_id];
+    player.input = reader.ReadU8();
+    player.is_grounded = reader.ReadBool();
+    player.kick_time = reader.ReadFloat();
+    player.can_kick = reader.ReadBool();
+  }
+
+  auto team_scores = gameplay_.team_scores;
+  for (auto& score : team_scores) {
+    score = reader.ReadInt();
+  }
+
+  if (reader.HasFailed()) {
+    return false;
+  }
+
+  world_.Restore(std::move(bodies), std::move(body_gen_indices),
+                 std::move(colliders), std::move(collider_gen_indices), pairs);
+  gameplay_.players = players;
+  gameplay_.team_scores = team_scores;
+  return true;
+}
+
+void Game::ComputeEntityHashes(MerkleTree& tree) {
+#ifdef TRACY_ENABLE
+  ZoneScoped;
+#endif
+  tree.Clear();
+
+  const auto add_leaf = [this, &tree](EntityKind kind, int entity_index) {
+    tree.AddLeaf(kind, entity_index,
+                 checksum::Crc32c(state_writer_.GetData(),
+                                  state_writer_.GetSize()));
+    state_writer_.Clear();
+  };
+
+  state_writer_.Clear();
+
+  const auto& bodies = world_.GetBodies();
+  for (std::size_t index = 0; index < bodies.size(); index++) {
+    state_writer_.WriteU32(
+        static_cast<std::uint32_t>(world_.BodyGenIndices[index]));
+    state_writer_.WriteBody(bodies[index]);
+    add_leaf(EntityKind::kBody, static_cast<int>(index));
+  }
+
+  const auto& colliders = world_.GetColliders();
+  for (std::size_t index = 0; index < colliders.size(); index++) {
+    state_writer_.WriteU32(
+        static_cast<std::uint32_t>(world_.ColliderGenIndices[index]));
+    state_writer_.WriteCollider(colliders[index]);
+    add_leaf(EntityKind::kCollider, static_cast<int>(index));
+  }
+
+  SerializeContacts(state_writer_);
+  add_leaf(EntityKind::kContacts, 0);
+
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    SerializePlayer(state_writer_, player_id);
+    add_leaf(EntityKind::kPlayer, player_id);
+  }
+
+  SerializeScores(state_writer_);
+  add_leaf(EntityKind::kScores, 0);
+
+  tree.Build();
 }
 
 void Game::CreateBall() noexcept {
-  /*ball_type_ =
+  /*gameplay_.ball_type =
       BallType::kFootball;*/  // static_cast<BallType>( GetRandomValue(0,
                               // static_cast<int>(BallType::kCount) - 1));
 
   const auto ballBodyRef = world_.CreateBody();
-  body_refs_.push_back(ballBodyRef);
   auto& ballBody = world_.GetBody(ballBodyRef);
 
   ballBody.Position = {metrics::kWindowWidth * 0.5f,
                        metrics::kWindowHeight * 0.5f};
 
   const auto ballColRef = world_.CreateCollider(ballBodyRef);
-  col_refs_.push_back(ballColRef);
   auto& ballCol = world_.GetCollider(ballColRef);
   ballCol.BodyPosition = ballBody.Position;
-  ball_body_ref_ = ballBodyRef;
+  gameplay_.ball_body_ref = ballBodyRef;
 
-  switch (ball_type_) {
+  switch (gameplay_.ball_type) {
     case BallType::kFootball:
       ballBody.Mass = 1.f;
       ballCol.Restitution = 1.5f;
-      ball_radius_ = metrics::kBallRadiusMedium;
+      gameplay_.ball_radius = metrics::kBallRadiusMedium;
       break;
     case BallType::kVolleyball:
       ballBody.Mass = 0.5f;
       ballCol.Restitution = 2.5f;
-      ball_radius_ = metrics::kBallRadiusMedium;
+      gameplay_.ball_radius = metrics::kBallRadiusMedium;
       break;
     case BallType::kBasketball:
       ballBody.Mass = 1.f;
       ballCol.Restitution = 1.9f;
-      ball_radius_ = metrics::kBallRadiusLarge;
+      gameplay_.ball_radius = metrics::kBallRadiusLarge;
       break;
     case BallType::kTennisball:
       ballBody.Mass = 0.5f;
       ballCol.Restitution = 2.95f;
-      ball_radius_ = metrics::kBallRadiusSmall;
+      gameplay_.ball_radius = metrics::kBallRadiusSmall;
       break;
     case BallType::kBaseball:
       ballBody.Mass = 1.f;
       ballCol.Restitution = 1.f;
-      ball_radius_ = metrics::kBallRadiusSmall;
+      gameplay_.ball_radius = metrics::kBallRadiusSmall;
       break;
   }
-  ballCol.Shape = Math::CircleF(Math::Vec2F::Zero(), ball_radius_);
-  ball_col_ref_ = ballColRef;
+  ballCol.Shape = Math::CircleF(Math::Vec2F::Zero(), gameplay_.ball_radius);
+  gameplay_.ball_col_ref = ballColRef;
 }
 
 void Game::CreateTerrain() noexcept {
   // Create ground
   const auto groundRef = world_.CreateBody();
-  body_refs_.push_back(groundRef);
   auto& groundBody = world_.GetBody(groundRef);
   groundBody.Type = BodyType::STATIC;
   groundBody.Mass = 1;
@@ -376,18 +716,16 @@ void Game::CreateTerrain() noexcept {
                          metrics::kWindowHeight - metrics::kGroundSize.Y};
 
   const auto groundColRef = world_.CreateCollider(groundRef);
-  col_refs_.push_back(groundColRef);
   auto& groundCol = world_.GetCollider(groundColRef);
   groundCol.Shape =
       Math::RectangleF({-metrics::kWindowWidth * 0.5f, 0},
                        {metrics::kWindowWidth * 0.5f, metrics::kGroundSize.Y});
   groundCol.BodyPosition = groundBody.Position;
   groundCol.Restitution = 0.f;
-  ground_col_ref_ = groundColRef;
+  gameplay_.ground_col_ref = groundColRef;
 
   // roof
   const auto roofRef = world_.CreateBody();
-  body_refs_.push_back(roofRef);
   auto& roofBody = world_.GetBody(roofRef);
   roofBody.Type = BodyType::STATIC;
   roofBody.Mass = 1;
@@ -395,7 +733,6 @@ void Game::CreateTerrain() noexcept {
   roofBody.Position = {metrics::kWindowWidth * 0.5f, 0};
 
   const auto roofColRef = world_.CreateCollider(roofRef);
-  col_refs_.push_back(roofColRef);
   auto& roofCol = world_.GetCollider(roofColRef);
   roofCol.Shape = Math::RectangleF({-metrics::kWindowWidth * 0.5f, 0},
                                    {metrics::kWindowWidth * 0.5f, 0});
@@ -404,7 +741,6 @@ void Game::CreateTerrain() noexcept {
 
   // wall left
   const auto leftWallRef = world_.CreateBody();
-  body_refs_.push_back(leftWallRef);
   auto& leftWallBody = world_.GetBody(leftWallRef);
   leftWallBody.Type = BodyType::STATIC;
   leftWallBody.Mass = 1;
@@ -412,7 +748,6 @@ void Game::CreateTerrain() noexcept {
   leftWallBody.Position = {0, metrics::kWindowHeight * 0.5f};
 
   const auto leftWallColRef = world_.CreateCollider(leftWallRef);
-  col_refs_.push_back(leftWallColRef);
   auto& leftWallCol = world_.GetCollider(leftWallColRef);
   leftWallCol.Shape = Math::RectangleF({0, -metrics::kWindowHeight * 0.5f},
                                        {0, metrics::kWindowHeight * 0.5f});
@@ -421,7 +756,6 @@ void Game::CreateTerrain() noexcept {
 
   // wall right
   const auto rightWallRef = world_.CreateBody();
-  body_refs_.push_back(rightWallRef);
   auto& rightWallBody = world_.GetBody(rightWallRef);
   rightWallBody.Type = BodyType::STATIC;
   rightWallBody.Mass = 1;
@@ -430,7 +764,6 @@ void Game::CreateTerrain() noexcept {
                             metrics::kWindowHeight * 0.5f};
 
   const auto rightWallColRef = world_.CreateCollider(rightWallRef);
-  col_refs_.push_back(rightWallColRef);
   auto& rightWallCol = world_.GetCollider(rightWallColRef);
   rightWallCol.Shape = Math::RectangleF({0, -metrics::kWindowHeight * 0.5f},
                                         {0, metrics::kWindowHeight * 0.5f});
@@ -439,7 +772,6 @@ void Game::CreateTerrain() noexcept {
 
   // goal left
   const auto leftGoalRef = world_.CreateBody();
-  body_refs_.push_back(leftGoalRef);
   auto& leftGoalBody = world_.GetBody(leftGoalRef);
   leftGoalBody.Type = BodyType::STATIC;
   leftGoalBody.Mass = 1;
@@ -448,7 +780,6 @@ void Game::CreateTerrain() noexcept {
                                   metrics::kGoalSize.Y};
 
   const auto leftGoalColRefRoof = world_.CreateCollider(leftGoalRef);
-  col_refs_.push_back(leftGoalColRefRoof);
   auto& leftGoalColRoof = world_.GetCollider(leftGoalColRefRoof);
 
   leftGoalColRoof.Shape =
@@ -459,7 +790,6 @@ void Game::CreateTerrain() noexcept {
   leftGoalColRoof.Restitution = 0.f;
 
   const auto leftGoalColRef = world_.CreateCollider(leftGoalRef);
-  col_refs_.push_back(leftGoalColRef);
   auto& leftGoalCol = world_.GetCollider(leftGoalColRef);
 
   leftGoalCol.IsTrigger = true;
@@ -470,11 +800,10 @@ void Game::CreateTerrain() noexcept {
   leftGoalCol.BodyPosition = leftGoalBody.Position;
   leftGoalCol.Restitution = 0.f;
 
-  left_goal_col_ref_ = leftGoalColRef;
+  gameplay_.left_goal_col_ref = leftGoalColRef;
 
   // goal right
   const auto rightGoalRef = world_.CreateBody();
-  body_refs_.push_back(rightGoalRef);
   auto& rightGoalBody = world_.GetBody(rightGoalRef);
   rightGoalBody.Type = BodyType::STATIC;
   rightGoalBody.Mass = 1;
@@ -484,7 +813,6 @@ void Game::CreateTerrain() noexcept {
       metrics::kWindowHeight - metrics::kGroundSize.Y - metrics::kGoalSize.Y};
 
   const auto rightGoalColRefRoof = world_.CreateCollider(rightGoalRef);
-  col_refs_.push_back(rightGoalColRefRoof);
   auto& rightGoalColRoof = world_.GetCollider(rightGoalColRefRoof);
 
   rightGoalColRoof.Shape =
@@ -495,7 +823,6 @@ void Game::CreateTerrain() noexcept {
   rightGoalColRoof.Restitution = 0.f;
 
   const auto rightGoalColRef = world_.CreateCollider(rightGoalRef);
-  col_refs_.push_back(rightGoalColRef);
   auto& rightGoalCol = world_.GetCollider(rightGoalColRef);
 
   rightGoalCol.IsTrigger = true;
@@ -506,85 +833,68 @@ void Game::CreateTerrain() noexcept {
   rightGoalCol.BodyPosition = rightGoalBody.Position;
   rightGoalCol.Restitution = 0.f;
 
-  right_goal_col_ref_ = rightGoalColRef;
+  gameplay_.right_goal_col_ref = rightGoalColRef;
 }
 
 void Game::CreatePlayers() noexcept {
-  // player blue
-  const auto p1BodyRef = world_.CreateBody();
-  body_refs_.push_back(p1BodyRef);
-  auto& p1Body = world_.GetBody(p1BodyRef);
-
-  p1Body.Mass = 1;
-
-  p1Body.Position = {metrics::kWindowWidth * 0.33f,
-                     metrics::kWindowHeight * 0.66f};
-
-  const auto p1ColRef = world_.CreateCollider(p1BodyRef);
-  col_refs_.push_back(p1ColRef);
-  auto& p1Col = world_.GetCollider(p1ColRef);
-  p1Col.Shape = Math::CircleF(Math::Vec2F::Zero(), metrics::kPlayerRadius);
-  p1Col.BodyPosition = p1Body.Position;
-  p1Col.Restitution = 0.f;
-  player_blue_body_ref_ = p1BodyRef;
-  player_blue_col_ref_ = p1ColRef;
-
-  // feets
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    auto& player = gameplay_.players[player_id];
 
-  const auto p1FeetsColRef = world_.CreateCollider(p1BodyRef);
-  col_refs_.push_back(p1FeetsColRef);
-  auto& p1FeetsCol = world_.GetCollider(p1FeetsColRef);
-  p1FeetsCol.Shape = Math::CircleF({metrics::kPlayerRadius * 2, 0},
-                                   metrics::kPlayerRadius * 0.5f);
-  p1FeetsCol.IsTrigger = true;
+    // The feet are on the side of the goal the player kicks to.
+    const float feet_direction =
+        GetPlayerTeam(player_id) == Team::kBlue ? 1.f : -1.f;
 
-  p1FeetsCol.Restitution = 1.f;
-  player_blue_feet_col_ref_ = p1FeetsColRef;
+    const auto bodyRef = world_.CreateBody();
+    auto& body = world_.GetBody(bodyRef);
 
-  // player red
+    body.Mass = 1;
 
-  const auto p2BodyRef = world_.CreateBody();
-  body_refs_.push_back(p2BodyRef);
-  auto& p2Body = world_.GetBody(p2BodyRef);
+    body.Position = GetSpawnPosition(player_id);
 
-  p2Body.Mass = 1;
+    const auto colRef = world_.CreateCollider(bodyRef);
+    auto& col = world_.GetCollider(colRef);
+    col.Shape = Math::CircleF(Math::Vec2F::Zero(), metrics::kPlayerRadius);
+    col.BodyPosition = body.Position;
+    col.Restitution = 0.f;
+    player.body_ref = bodyRef;
+    player.col_ref = colRef;
 
-  p2Body.Position = {metrics::kWindowWidth - metrics::kWindowWidth * 0.33f,
-                     metrics::kWindowHeight * 0.66f};
+    // feets
 
-  const auto p2ColRef = world_.CreateCollider(p2BodyRef);
-  col_refs_.push_back(p2ColRef);
-  auto& p2Col = world_.GetCollider(p2ColRef);
-  p2Col.Shape = Math::CircleF(Math::Vec2F::Zero(), metrics::kPlayerRadius);
-  p2Col.BodyPosition = p2Body.Position;
-  p2Col.Restitution = 0.f;
-  player_red_body_ref_ = p2BodyRef;
-  player_red_col_ref_ = p2ColRef;
+    const auto feetsColRef = world_.CreateCollider(bodyRef);
+    auto& feetsCol = world_.GetCollider(feetsColRef);
+    feetsCol.Shape =
+        Math::CircleF({feet_direction * metrics::kPlayerRadius * 2, 0},
+                      metrics::kPlayerRadius * 0.5f);
+    feetsCol.IsTrigger = true;
 
-  // feets
+    feetsCol.Restitution = 1.f;
+    player.feet_col_ref = feetsColRef;
+  }
+}
 
-  const auto p2FeetsColRef = world_.CreateCollider(p2BodyRef);
-  col_refs_.push_back(p2FeetsColRef);
-  auto& p2FeetsCol = world_.GetCollider(p2FeetsColRef);
-  p2FeetsCol.Shape = Math::CircleF({-metrics::kPlayerRadius * 2, 0},
-                                   metrics::kPlayerRadius * 0.5f);
-  p2FeetsCol.IsTrigger = true;
+Math::Vec2F Game::GetSpawnPosition(int player_id) noexcept {
+  // The teammates line up behind each other, toward their own goal.
+  const float team_offset =
+      metrics::kWindowWidth * 0.33f - (player_id / 2) * kPlayerSpacing;
 
-  p2FeetsCol.Restitution = 1.f;
-  player_red_feet_col_ref_ = p2FeetsColRef;
+  if (GetPlayerTeam(player_id) == Team::kBlue) {
+    return {team_offset, metrics::kWindowHeight * 0.66f};
+  }
+  return {metrics::kWindowWidth - team_offset, metrics::kWindowHeight * 0.66f};
 }
 
 void Game::ResetPositions() noexcept {
-  auto& ball = world_.GetBody(ball_body_ref_);
+  gameplay_.has_global_interaction = true;
+
+  auto& ball = world_.GetBody(gameplay_.ball_body_ref);
   ball.Position = {metrics::kWindowWidth * 0.5f, metrics::kWindowHeight * 0.5f};
   ball.Velocity = Math::Vec2F::Zero();
 
-  auto& p1 = world_.GetBody(player_blue_body_ref_);
-  p1.Position = {metrics::kWindowWidth * 0.33f, metrics::kWindowHeight * 0.66f};
-  p1.Velocity = Math::Vec2F::Zero();
-
-  auto& p2 = world_.GetBody(player_red_body_ref_);
-  p2.Position = {metrics::kWindowWidth - metrics::kWindowWidth * 0.33f,
-                 metrics::kWindowHeight * 0.66f};
-  p2.Velocity = Math::Vec2F::Zero();
+  for (int player_id = 0; player_id < gameplay_.player_count; player_id++) {
+    auto& player_body =
+        world_.GetBody(gameplay_.players[player_id].body_ref);
+    player_body.Position = GetSpawnPosition(player_id);
+    player_body.Velocity = Math::Vec2F::Zero();
+  }
 }
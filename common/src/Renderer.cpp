@@ -125,18 +125,29 @@ void Renderer::SetupPlayers() {
 void Renderer::DrawMenu() {
   const char* text = "Start Game";
   start_btn_text_color_ = raylib::WHITE;
+  spectate_btn_text_color_ = raylib::WHITE;
+  bool can_spectate = false;
   if (!network_->IsConnected()) {
     text = "Waiting for connection";
   } else {
     if (isWaitingOtherPlayer) {
-      text = "Waiting for other player";
+      text = network_->IsSpectator() ? "Looking for a game"
+                                     : "Waiting for other player";
     } else {
+      can_spectate = true;
       if (CheckCollisionPointRec(raylib::GetMousePosition(), start_btn_rect)) {
         start_btn_text_color_ = raylib::YELLOW;
         if (raylib::IsMouseButtonPressed(0)) {
           isWaitingOtherPlayer = true;
           network_->JoinRandomOrCreateRoom();
         }
+      } else if (CheckCollisionPointRec(raylib::GetMousePosition(),
+                                        spectate_btn_rect)) {
+        spectate_btn_text_color_ = raylib::YELLOW;
+        if (raylib::IsMouseButtonPressed(0)) {
+          isWaitingOtherPlayer = true;
+          network_->JoinAsSpectator();
+        }
       }
     }
   }
@@ -147,22 +158,32 @@ void Renderer::DrawMenu() {
                          metrics::kWindowWidth * 0.5f -
                              raylib::MeasureText(text, kFontSize) * 0.5f,
                          metrics::kWindowHeight * 0.2f + 30, 30, raylib::BLACK);
+
+  if (can_spectate) {
+    const char* spectate_text = "Spectate";
+    DrawRectangleRec(spectate_btn_rect, spectate_btn_text_color_);
+    raylib::DrawRaylibText(
+        spectate_text,
+        metrics::kWindowWidth * 0.5f -
+            raylib::MeasureText(spectate_text, kFontSize) * 0.5f,
+        metrics::kWindowHeight * 0.35f + 30, 30, raylib::BLACK);
+  }
 }
 
 void Renderer::DrawScore() {
   raylib::DrawRaylibText(
-      std::to_string(game_->GetBlueScore()).c_str(),
+      std::to_string(game_->GetTeamScore(Team::kBlue)).c_str(),
       metrics::kWindowWidth * 0.33f -
-          raylib::MeasureText(std::to_string(game_->GetBlueScore()).c_str(),
-                              100) *
+          raylib::MeasureText(
+              std::to_string(game_->GetTeamScore(Team::kBlue)).c_str(), 100) *
               0.5f,
       metrics::kWindowHeight * 0.33f, 100, raylib::BLUE);
 
   raylib::DrawRaylibText(
-      std::to_string(game_->GetRedScore()).c_str(),
+      std::to_string(game_->GetTeamScore(Team::kRed)).c_str(),
       metrics::kWindowWidth * 0.66f -
-          raylib::MeasureText(std::to_string(game_->GetRedScore()).c_str(),
-                              100) *
+          raylib::MeasureText(
+              std::to_string(game_->GetTeamScore(Team::kRed)).c_str(), 100) *
               0.5f,
       metrics::kWindowHeight * 0.33f, 100, raylib::RED);
 }
@@ -172,8 +193,8 @@ void Renderer::DrawEndGame() {
   DrawScore();
   DrawPlayers();
 
-  int blueScore = game_->GetBlueScore();
-  int redScore = game_->GetRedScore();
+  int blueScore = game_->GetTeamScore(Team::kBlue);
+  int redScore = game_->GetTeamScore(Team::kRed);
 
   const char* text = "";
   auto color = raylib::BLACK;
@@ -215,7 +236,7 @@ void Renderer::DrawEndGame() {
 }
 
 void Renderer::DrawTimer() {
-  int totalTime = 90 - game_time_;
+  int totalTime = metrics::kGameDuration - game_time_;
   int minutes = totalTime / 60;
   int seconds = totalTime % 60;
 
@@ -251,28 +272,31 @@ void Renderer::DrawBall() {
 }
 
 void Renderer::DrawPlayers() {
-  const auto playerBluePos = game_->GetPlayerBluePos();
-  const auto playerRedPos = game_->GetPlayerRedPos();
-
-  player_blue_.Draw({playerBluePos.X, playerBluePos.Y});
+  for (int player_id = 0; player_id < game_->GetPlayerCount(); player_id++) {
+    const auto playerPos = game_->GetPlayerPos(player_id);
 
-  player_red_.Draw({playerRedPos.X, playerRedPos.Y});
+    if (GetPlayerTeam(player_id) == Team::kBlue) {
+      player_blue_.Draw({playerPos.X, playerPos.Y});
 
-  player_blue_left_feet_.Draw(
-      {playerBluePos.X, playerBluePos.Y + metrics::kPlayerRadius +
+      player_blue_left_feet_.Draw(
+          {playerPos.X, playerPos.Y + metrics::kPlayerRadius +
                             player_blue_left_feet_.dest.height * 0.5f});
 
-  player_blue_right_feet_.Draw(
-      {playerBluePos.X, playerBluePos.Y + metrics::kPlayerRadius +
+      player_blue_right_feet_.Draw(
+          {playerPos.X, playerPos.Y + metrics::kPlayerRadius +
                             player_blue_right_feet_.dest.height * 0.5f});
+    } else {
+      player_red_.Draw({playerPos.X, playerPos.Y});
 
-  player_red_left_feet_.Draw(
-      {playerRedPos.X, playerRedPos.Y + metrics::kPlayerRadius +
-                           player_red_left_feet_.dest.height * 0.5f});
+      player_red_left_feet_.Draw(
+          {playerPos.X, playerPos.Y + metrics::kPlayerRadius +
+                            player_red_left_feet_.dest.height * 0.5f});
 
-  player_red_right_feet_.Draw(
-      {playerRedPos.X, playerRedPos.Y + metrics::kPlayerRadius +
-                           player_red_right_feet_.dest.height * 0.5f});
+      player_red_right_feet_.Draw(
+          {playerPos.X, playerPos.Y + metrics::kPlayerRadius +
+                            player_red_right_feet_.dest.height * 0.5f});
+    }
+  }
 }
 
 void Renderer::DrawTerrain() {
@@ -294,14 +318,13 @@ void Renderer::DrawHitbox() {
                         metrics::kWindowWidth, metrics::kGroundSize.Y,
                         raylib::GREEN);  // ground
 
-  const auto playerBluePos = game_->GetPlayerBluePos();
-  const auto playerRedPos = game_->GetPlayerRedPos();
-
-  raylib::DrawCircle(playerBluePos.X, playerBluePos.Y, metrics::kPlayerRadius,
-                     raylib::BLUE);  // player blue
-
-  raylib::DrawCircle(playerRedPos.X, playerRedPos.Y, metrics::kPlayerRadius,
-                     raylib::RED);  // player red
+  for (int player_id = 0; player_id < game_->GetPlayerCount(); player_id++) {
+    const auto playerPos = game_->GetPlayerPos(player_id);
+    raylib::DrawCircle(playerPos.X, playerPos.Y, metrics::kPlayerRadius,
+                       GetPlayerTeam(player_id) == Team::kBlue
+                           ? raylib::BLUE
+                           : raylib::RED);  // player
+  }
 
   raylib::DrawRectangle(
       0, metrics::kWindowHeight - metrics::kGroundSize.Y - metrics::kGoalSize.Y,
@@ -1,5 +1,12 @@
 #include "application.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <iterator>
+#include <limits>
+#include <tuple>
+
 // Update and Draw one frame
 void UpdateDrawFrame(void* renderer) {
   static_cast<Renderer*>(renderer)->Draw();
@@ -11,6 +18,21 @@ void Application::Setup() {
   renderer_.Setup(&game_, &network_);
   audio_.Setup();
 
+#ifndef PLATFORM_WEB
+  // Keep a core for the main thread, the others speculate on the remote
+  // inputs.
+  const auto core_count = static_cast<int>(std::thread::hardware_concurrency());
+  rollback_.EnableSpeculation(core_count - 1);
+#endif
+  rollback_.SetResimulationBudget(metrics::kResimulationBudget);
+
+  // Logs the rollback metrics of every second when a path is given.
+  if (const char* csv_path = std::getenv("ROLLBACK_TELEMETRY_CSV")) {
+    if (!rollback_.GetTelemetry().OpenCsv(csv_path)) {
+      std::cerr << "Could not open the telemetry file " << csv_path << '\n';
+    }
+  }
+
   network_.Connect();
 }
 
@@ -24,6 +46,7 @@ void Application::Run() {
   while (!WindowShouldClose()) {
     audio_.Update();
     network_.Service();
+    ReceivePackets();
     switch (game_.GetState()) {
       case GameState::kMenu:
         break;
@@ -35,15 +58,64 @@ void Application::Run() {
         game_time_ += game_timer_.DeltaTime;
 
         time += game_timer_.DeltaTime;
-        while (time >= metrics::kFixedDeltaTime) {
+
+        if (network_.IsSpectator()) {
+          HandleSpectatorPackets();
+          while (time >= metrics::kFixedDeltaTime) {
+            spectator_.Update();
+            time -= metrics::kFixedDeltaTime;
+          }
+          if (spectator_.IsFinished()) {
+            game_.EndGame();
+            network_.LeaveRoom();
+          }
+          renderer_.SetGameTime(static_cast<float>(spectator_.GetFrame() + 1) *
+                                metrics::kFixedDeltaTime);
+          break;
+        }
+
+        SendStateChunks();
+
+        // The peer that runs ahead stretches its fixed step until the others
+        // catch up, the simulation still advances by kFixedDeltaTime.
+        const float fixed_step =
+            metrics::kFixedDeltaTime * time_sync_.GetStepScale();
+        // The fixed steps of this frame share the resimulation budget.
+        rollback_.StartRenderFrame();
+        while (time >= fixed_step) {
+          if (is_waiting_for_state_) {
+            // The simulation resumes from the state of the master client.
+            HandlePacket();
+            if (std::chrono::steady_clock::now() - last_state_time_ >
+                kStateRequestTimeout) {
+              SendStateRequest();
+            }
+            time -= fixed_step;
+            continue;
+          }
+
+          input_delay_.Update(network_.GetRoundTripTime(),
+                              network_.GetRoundTripTimeVariance());
+
+          if (!rollback_.CanIncreaseCurrentFrame(input_delay_.GetDelay())) {
+            // The other player is too far behind, wait for its inputs.
+            HandlePacket();
+            HandleConfirmedFrames();
+            time -= fixed_step;
+            continue;
+          }
+
           rollback_.IncreaseCurrentFrame();
           if (rollback_.GetCurentFrame() >= metrics::kGameFrameNbr) {
             game_.EndGame();
             network_.LeaveRoom();
             break;
           }
+          time_sync_.Update(rollback_.GetCurentFrame(),
+                            network_.GetRoundTripTime());
 
           HandlePacket();
+          HandleConfirmedFrames();
 
           input::Input actualInput = 0;
 
@@ -60,43 +132,59 @@ void Application::Run() {
             actualInput |= input::kKick;
           }
 
-          const input::FrameInput frame_input{actualInput,
-                                              rollback_.GetCurentFrame()};
-          rollback_.SetPlayerInput(frame_input, game_.player_nbr);
-
-          inputs_.push_back(actualInput);
-          frames_.push_back(rollback_.GetCurentFrame());
-
-          ExitGames::Common::Hashtable event_data;
-          event_data.put(static_cast<nByte>(PacketKey::kInput), inputs_.data(),
-                         static_cast<int>(inputs_.size()));
-          event_data.put(static_cast<nByte>(PacketKey::kFrame), frames_.data(),
-                         static_cast<int>(frames_.size()));
-
-          network_.RaiseEvent(false, PacketType::kInput, event_data);
-
-          for (size_t i = 0; i < 2; i++) {
-            const auto input = rollback_.GetLastPlayerInput(i);
-            if (i == game_.player_nbr) {
-              game_.SetPlayerInput(input);
-            } else {
-              game_.SetOtherPlayerInput(input);
-            }
+          // The input is applied a few frames later to hide the latency.
+          // When the delay grows, the frames in between get the same input.
+          // When it shrinks, no input is scheduled until the current frame
+          // catches up with the last scheduled one.
+          const int input_frame =
+              rollback_.GetCurentFrame() + input_delay_.GetDelay();
+          for (int frame = rollback_.GetLastInputFrame(game_.player_nbr) + 1;
+               frame <= input_frame; frame++) {
+            const input::FrameInput frame_input{actualInput, frame};
+            rollback_.SetPlayerInput(frame_input, game_.player_nbr);
+            local_inputs_.push_back(frame_input);
           }
+          SendInputs();
 
-          game_.Update();
+          rollback_.SimulateCurrentFrame();
 
-          time -= metrics::kFixedDeltaTime;
+          time -= fixed_step;
         }
 
         renderer_.SetGameTime(game_time_);
       } break;
       case GameState::kGameFinished:
         time = metrics::kFixedDeltaTime;
+        if (!confirmed_frames_.empty()) {
+          SaveReplay();
+        }
         rollback_.Reset();
         while (!packet_queue.empty()) {
           packet_queue.pop();
         }
+        network_.ClearPackets();
+        local_inputs_.clear();
+        input_acks_.fill({});
+        reliable_input_frame_ = -1;
+        loaded_state_count_ = 0;
+        while (!remote_confirmations_.empty()) {
+          remote_confirmations_.pop();
+        }
+        desync_frame_ = -1;
+        dumped_frame_ = -1;
+        confirmed_frames_.clear();
+        for (auto& state_sender : state_senders_) {
+          state_sender.Reset();
+        }
+        state_receiver_.Reset();
+        pending_confirmations_.clear();
+        for (auto& pending_inputs : pending_inputs_) {
+          pending_inputs.clear();
+        }
+        is_waiting_for_state_ = false;
+        input_delay_.Reset();
+        time_sync_.Reset();
+        spectator_.Reset();
         game_time_ = 0;
         // network leave room
         break;
@@ -117,164 +205,691 @@ void Application::TearDown() {
   game_.TearDown();
 }
 
+void Application::StartSpectating() noexcept { spectator_.Start(&game_); }
+
+void Application::HandleSpectatorPackets() {
+  while (!packet_queue.empty()) {
+    const auto& packet = packet_queue.front();
+
+    // A spectator only needs the frames confirmed by the master client.
+    if (packet.type == PacketType::kFrameConfirmation) {
+      const auto confirmed_frame = ReadConfirmedFrame(packet);
+      if (spectator_.AddConfirmedFrame(confirmed_frame)) {
+        confirmed_frames_.push_back(confirmed_frame);
+      }
+    }
+
+    packet_queue.pop();
+  }
+}
+
 void Application::HandlePacket() {
   while (!packet_queue.empty()) {
     const auto& packet = packet_queue.front();
 
     switch (packet.type) {
       case PacketType::kInput: {
-        std::vector<input::FrameInput> frameInputs;
-        const auto input_value =
-            packet.data.getValue(static_cast<nByte>(PacketKey::kInput));
+        StateReader reader(packet.data);
+        const int remote_frame = reader.ReadInt();
+        const int remote_loaded_state_count = reader.ReadInt();
+        const auto advantages = packet::ReadInts(reader);
+        const auto acked_frames = packet::ReadInts(reader);
+        const int first_frame = reader.ReadInt();
+        const auto inputs = packet::ReadBytes(reader);
+        if (reader.HasFailed() || packet.player_nbr < 0 ||
+            packet.player_nbr >= metrics::kMaxPlayerNbr) {
+          std::cerr << "Invalid input packet from player "
+                    << packet.player_nbr << '\n';
+          break;
+        }
 
-        const input::Input* inputs =
-            ExitGames::Common::ValueObject<input::Input*>(input_value)
-                .getDataCopy();
+        if (game_.player_nbr < static_cast<int>(advantages.size())) {
+          time_sync_.OnRemoteFrame(packet.player_nbr, remote_frame,
+                                   advantages[game_.player_nbr]);
+        }
+        // The packets may arrive out of order, keep the acknowledgment of the
+        // newest one. It goes back when the player loads a state.
+        if (game_.player_nbr < static_cast<int>(acked_frames.size())) {
+          auto& ack = input_acks_[packet.player_nbr];
+          const int acked_frame = acked_frames[game_.player_nbr];
+          if (std::tie(remote_loaded_state_count, remote_frame) >=
+              std::tie(ack.loaded_state_count, ack.remote_frame)) {
+            if (remote_loaded_state_count != ack.loaded_state_count) {
+              // The inputs sent reliably before the state are sent again.
+              reliable_input_frame_ =
+                  std::min(reliable_input_frame_, acked_frame);
+            }
+            ack = {remote_loaded_state_count, remote_frame, acked_frame};
+          }
+        }
+
+        std::vector<input::FrameInput> frameInputs;
+        for (std::size_t i = 0; i < inputs.size(); i++) {
+          input::FrameInput frame_input{
+              inputs[i], first_frame + static_cast<int>(i)};
+          frameInputs.push_back(frame_input);
+        }
 
-        const int inputs_count =
-            *ExitGames::Common::ValueObject<input::Input*>(input_value)
-                 .getSizes();
+        // The state forgets the inputs after it, the ones received meanwhile
+        // are set once it is loaded.
+        if (is_waiting_for_state_) {
+          auto& pending_inputs = pending_inputs_[packet.player_nbr];
+          for (const auto& frame_input : frameInputs) {
+            pending_inputs[frame_input.frame_nbr] = frame_input.input;
+          }
+          break;
+        }
 
-        const auto frame_value =
-            packet.data.getValue(static_cast<nByte>(PacketKey::kFrame));
+        if (frameInputs.empty() ||
+            frameInputs.back().frame_nbr <
+                rollback_.GetLastInputFrame(packet.player_nbr)) {
+          // received old input, no need to confirm frames.
+          break;
+        }
 
-        const short* frames =
-            ExitGames::Common::ValueObject<short*>(frame_value).getDataCopy();
+        rollback_.SetOtherPlayerInput(frameInputs, packet.player_nbr);
 
-        for (int i = 0; i < inputs_count; i++) {
-          input::FrameInput frame_input{inputs[i], frames[i]};
-          frameInputs.push_back(frame_input);
+        if (game_.player_nbr == 0) {
+          ConfirmFrames();
+        }
+      } break;
+      case PacketType::kFrameConfirmation: {
+        const auto remote_confirmation = ReadConfirmedFrame(packet);
+        if (remote_confirmation.frame_nbr < 0) {
+          std::cerr << "Invalid frame confirmation packet\n";
+          break;
+        }
+        if (is_waiting_for_state_) {
+          // Replayed on top of the state once it is loaded.
+          pending_confirmations_.push_back(remote_confirmation);
+          break;
         }
 
-        if (frameInputs.back().frame_nbr <
-            rollback_.GetLastRemoteInputFrame()) {
-          // received old input, no need to send confirm packet.
-          return;
+        const int confirmed_frame = remote_confirmation.frame_nbr;
+        if (confirmed_frame <= rollback_.GetConfirmedFrame()) {
+          // The state of the master client can be newer than the
+          // confirmations it sent, the older ones arrive after it is loaded.
+          AddRestoredConfirmation(remote_confirmation);
+          break;
+        }
+        if (rollback_.GetCurentFrame() == rollback_.GetConfirmedFrame()) {
+          // Nothing was simulated since the state of the master client was
+          // loaded, catch up with the frames it confirmed meanwhile.
+          ReplayConfirmation(remote_confirmation);
+          break;
         }
 
-        rollback_.SetOtherPlayerInput(frameInputs,
-                                      game_.player_nbr == 0 ? 1 : 0);
+        // The confirmation carries the input of every player at the
+        // confirmed frame, add the ones we did not receive yet.
+        for (int player_id = 0; player_id < rollback_.GetPlayerCount();
+             player_id++) {
+          if (rollback_.GetLastInputFrame(player_id) < confirmed_frame) {
+            const input::FrameInput frame_input{
+                remote_confirmation.inputs[player_id], confirmed_frame};
+            rollback_.SetOtherPlayerInput({frame_input}, player_id);
+          }
+        }
 
-        if (game_.player_nbr == 0) {
-          SendFrameConfirmation(frameInputs);
+        if (confirmed_frame != rollback_.GetFrameToConfirm()) {
+          std::cerr << "Unexpected frame confirmation: " << confirmed_frame
+                    << '\n';
+          break;
         }
 
-        ExitGames::Common::MemoryManagement::deallocateArray(inputs);
-        ExitGames::Common::MemoryManagement::deallocateArray(frames);
+        rollback_.ConfirmFrame();
+
+        // Our checksum of the frame is computed later by the confirmation
+        // worker.
+        remote_confirmations_.push(remote_confirmation);
 
+        EraseConfirmedInputs(confirmed_frame);
       } break;
-      case PacketType::kFrameConfirmation: {
+      case PacketType::kMerkleRequest: {
         if (game_.player_nbr == 0) {
-          inputs_.erase(inputs_.begin());
-          frames_.erase(frames_.begin());
-          break;
+          // The search of a desync starts with a request of the root, dump
+          // our side of the desync once.
+          StateReader reader(packet.data);
+          const int frame_nbr = reader.ReadInt();
+          if (frame_nbr != dumped_frame_) {
+            DumpDesync(frame_nbr);
+          }
+          SendMerkleReply(packet);
+        }
+      } break;
+      case PacketType::kMerkleReply: {
+        HandleMerkleReply(packet);
+      } break;
+      case PacketType::kStateRequest: {
+        HandleStateRequest(packet);
+      } break;
+      case PacketType::kStateChunk: {
+        HandleStateChunk(packet);
+      } break;
+      case PacketType::kStateAck: {
+        StateReader reader(packet.data);
+        const int transfer_id = reader.ReadInt();
+        const auto chunk_indices = packet::ReadInts(reader);
+        if (!reader.HasFailed() && game_.player_nbr == 0 &&
+            packet.player_nbr > 0 &&
+            packet.player_nbr < rollback_.GetPlayerCount()) {
+          state_senders_[packet.player_nbr].OnAck(transfer_id, chunk_indices);
         }
+      } break;
+    }
+    packet_queue.pop();
+  }
+}
 
-        int checksum = 0;
-        std::vector<input::FrameInput> frame_inputs{};
+void Application::ConfirmFrames() noexcept {
+  // Confirm every frame for which the inputs of all the players are known.
+  // The inputs received ahead of the current frame wait for it to reach them.
+  const int last_frame = std::min(rollback_.GetConfirmationFrontier(),
+                                  rollback_.GetCurentFrame());
+  while (rollback_.GetFrameToConfirm() <= last_frame) {
+    rollback_.ConfirmFrame();
+  }
+}
 
-        const auto checksum_value =
-            packet.data.getValue(static_cast<nByte>(PacketKey::kChecksum));
-        checksum =
-            ExitGames::Common::ValueObject<int>(checksum_value).getDataCopy();
+void Application::HandleConfirmedFrames() noexcept {
+  ConfirmedFrame confirmed_frame{};
 
-        const auto input_value =
-            packet.data.getValue(static_cast<nByte>(PacketKey::kInput));
+  while (rollback_.PollConfirmedFrame(confirmed_frame)) {
+    confirmed_frames_.push_back(confirmed_frame);
 
-        const input::Input* inputs =
-            ExitGames::Common::ValueObject<input::Input*>(input_value)
-                .getDataCopy();
+    if (game_.player_nbr == 0) {
+      // Send the checksum and the inputs of the confirmed frame to the other
+      // players.
+      auto& writer = StartPacket(PacketType::kFrameConfirmation);
+      writer.WriteInt(confirmed_frame.frame_nbr);
+      writer.WriteInt(confirmed_frame.checksum);
+      writer.WriteU32(confirmed_frame.merkle_root);
+      packet::WriteBytes(writer, confirmed_frame.inputs.data(),
+                         rollback_.GetPlayerCount());
 
-        const int inputs_count =
-            *ExitGames::Common::ValueObject<input::Input*>(input_value)
-                 .getSizes();
+      // The confirmations are cached by the room so the spectators who join
+      // later can play the game from its start.
+      network_.SendCached(writer.GetData(), writer.GetSize());
 
-        const auto frame_value =
-            packet.data.getValue(static_cast<nByte>(PacketKey::kFrame));
+      EraseConfirmedInputs(confirmed_frame.frame_nbr);
+      continue;
+    }
 
-        const short* frames =
-            ExitGames::Common::ValueObject<short*>(frame_value).getDataCopy();
+    // Compare with the checksum received from the master client, the
+    // confirmations of both sides are in frame order.
+    const int frame_nbr = confirmed_frame.frame_nbr;
+    while (!remote_confirmations_.empty() &&
+           remote_confirmations_.front().frame_nbr < frame_nbr) {
+      remote_confirmations_.pop();
+    }
+    if (remote_confirmations_.empty() ||
+        remote_confirmations_.front().frame_nbr != frame_nbr) {
+      continue;
+    }
 
-        for (int i = 0; i < inputs_count; i++) {
-          input::FrameInput frame_input{inputs[i], frames[i]};
-          frame_inputs.push_back(frame_input);
-        }
+    const auto& remote_confirmation = remote_confirmations_.front();
+    if (remote_confirmation.checksum != confirmed_frame.checksum ||
+        remote_confirmation.merkle_root != confirmed_frame.merkle_root) {
+      std::cerr << "Not same checksum for frame: " << frame_nbr << '\n';
+
+      // Only look for the first desync, the next frames diverge because of
+      // it.
+      if (desync_frame_ == -1) {
+        desync_frame_ = frame_nbr;
+        DumpDesync(frame_nbr);
+        SendMerkleRequest(frame_nbr, {MerkleTree::kRootNode});
+      }
+
+      // Start again from the state of the master client instead of playing
+      // the rest of the match on a wrong state.
+      RequestState();
+      return;
+    }
+    remote_confirmations_.pop();
+  }
+}
 
-        // If we did not receive the inputs before the frame to confirm, add
-        // them.
-        if (rollback_.GetLastRemoteInputFrame() <
-            frame_inputs.back().frame_nbr) {
-          const int other_client_id = game_.player_nbr == 0 ? 1 : 0;
-          rollback_.SetOtherPlayerInput(frame_inputs, other_client_id);
-        }
+void Application::SendMerkleRequest(int frame_nbr,
+                                    const std::vector<int>& nodes) noexcept {
+  auto& writer = StartPacket(PacketType::kMerkleRequest);
+  writer.WriteInt(frame_nbr);
+  packet::WriteInts(writer, nodes.data(), static_cast<int>(nodes.size()));
+  SendPacket(true);
+}
+
+void Application::SendMerkleReply(const Packet& request) noexcept {
+  StateReader reader(request.data);
+  const int frame_nbr = reader.ReadInt();
+  const auto nodes = packet::ReadInts(reader);
+  if (reader.HasFailed()) {
+    return;
+  }
+
+  auto& writer = StartPacket(PacketType::kMerkleReply);
+  writer.WriteInt(frame_nbr);
+  packet::WriteInts(writer, nodes.data(), static_cast<int>(nodes.size()));
+
+  // Without the hashes, the requester knows the frame is too old.
+  MerkleTree tree;
+  const bool has_hashes = rollback_.CopyMerkleTree(frame_nbr, tree);
+  writer.WriteBool(has_hashes);
+  if (has_hashes) {
+    std::vector<int> hashes;
+    hashes.reserve(nodes.size());
+    for (const auto node : nodes) {
+      const bool is_valid = node >= MerkleTree::kRootNode &&
+                            node < tree.GetNodeCount();
+      hashes.push_back(is_valid ? static_cast<int>(tree.GetNode(node)) : 0);
+    }
+    packet::WriteInts(writer, hashes.data(), static_cast<int>(hashes.size()));
+  }
 
-        const int check_sum = rollback_.ConfirmFrame();
+  SendPacket(true);
+}
 
-        if (check_sum != checksum) {
-          std::cerr << "Not same checksum for frame: "
-                    << rollback_.GetFrameToConfirm() << '\n';
-          return;
-        }
+void Application::HandleMerkleReply(const Packet& reply) noexcept {
+  StateReader reader(reply.data);
+  const int frame_nbr = reader.ReadInt();
+  const auto nodes = packet::ReadInts(reader);
+  const bool has_hashes = reader.ReadBool();
+  if (reader.HasFailed() || frame_nbr != desync_frame_) {
+    // An answer to the request of another player.
+    return;
+  }
 
-        // Send a frame confirmation event with empty data to the master client
-        // just to tell him that we confirmed the frame and that he can erase
-        // the input at the confirmed frame in its vector of inputs.
-        network_.RaiseEvent(true, PacketType::kFrameConfirmation,
-                            ExitGames::Common::Hashtable());
+  MerkleTree tree;
+  if (!has_hashes || !rollback_.CopyMerkleTree(frame_nbr, tree)) {
+    std::cerr << "The state of frame " << frame_nbr
+              << " is too old to find the desync.\n";
+    desync_frame_ = -1;
+    return;
+  }
 
-        inputs_.erase(inputs_.begin());
-        frames_.erase(frames_.begin());
-        ExitGames::Common::MemoryManagement::deallocateArray(inputs);
-        ExitGames::Common::MemoryManagement::deallocateArray(frames);
-      } break;
+  const auto hashes = packet::ReadInts(reader);
+
+  // Go down the subtrees whose hashes differ until the leaves.
+  std::vector<int> next_nodes;
+  for (std::size_t i = 0; i < nodes.size() && i < hashes.size(); i++) {
+    const int node = nodes[i];
+    if (node < MerkleTree::kRootNode || node >= tree.GetNodeCount() ||
+        tree.GetNode(node) == static_cast<std::uint32_t>(hashes[i])) {
+      continue;
     }
-    packet_queue.pop();
+
+    if (tree.IsLeaf(node)) {
+      std::cerr << "Desync at frame " << frame_nbr << " in "
+                << tree.DescribeLeaf(node) << '\n';
+    } else {
+      next_nodes.push_back(2 * node);
+      next_nodes.push_back(2 * node + 1);
+    }
+  }
+
+  if (next_nodes.empty()) {
+    desync_frame_ = -1;
+    return;
   }
+  SendMerkleRequest(frame_nbr, next_nodes);
 }
 
-void Application::SendFrameConfirmation(
-    const std::vector<input::FrameInput>& remote_frame_inputs) noexcept {
-  auto frame_to_confirm_it = std::find_if(
-      remote_frame_inputs.begin(), remote_frame_inputs.end(),
-      [this](const input::FrameInput& frame_input) {
-        return frame_input.frame_nbr == rollback_.GetFrameToConfirm();
-      });
+void Application::DumpDesync(int frame_nbr) noexcept {
+  dumped_frame_ = frame_nbr;
+
+  DesyncDump dump;
+  dump.player_count = rollback_.GetPlayerCount();
+  dump.ball_type = game_.GetBallType();
+  dump.player_nbr = game_.player_nbr;
+  dump.frame_nbr = frame_nbr;
+
+  // The state the checksum was computed on, empty if it is too old.
+  rollback_.CopyConfirmedState(frame_nbr, dump.state);
+
+  for (const auto& confirmed_frame : confirmed_frames_) {
+    if (confirmed_frame.frame_nbr > frame_nbr) {
+      break;
+    }
+    dump.confirmed_frames.push_back(confirmed_frame);
+  }
+
+  const auto path = "desync_frame" + std::to_string(frame_nbr) + "_player" +
+                    std::to_string(game_.player_nbr) + ".bin";
+  if (dump.Save(path)) {
+    std::cerr << "Desync dumped to " << path << '\n';
+  } else {
+    std::cerr << "Could not write the desync dump " << path << '\n';
+  }
+}
+
+void Application::RequestState() noexcept {
+  if (game_.player_nbr == 0 || is_waiting_for_state_) {
+    return;
+  }
+  is_waiting_for_state_ = true;
+  state_receiver_.Reset();
+  pending_confirmations_.clear();
+  for (auto& pending_inputs : pending_inputs_) {
+    pending_inputs.clear();
+  }
+  // Our checksums are compared again from the state.
+  while (!remote_confirmations_.empty()) {
+    remote_confirmations_.pop();
+  }
+  SendStateRequest();
+}
+
+void Application::SendStateRequest() noexcept {
+  last_state_time_ = std::chrono::steady_clock::now();
+
+  StartPacket(PacketType::kStateRequest);
+  SendPacket(true, 0);
+}
+
+void Application::HandleStateRequest(const Packet& request) noexcept {
+  // Nothing is confirmed before the first frame, the request is sent again.
+  if (game_.player_nbr != 0 || request.player_nbr <= 0 ||
+      request.player_nbr >= rollback_.GetPlayerCount() ||
+      rollback_.GetConfirmedFrame() < 0) {
+    return;
+  }
+  // The state is at the last frame confirmed by our rollback, the worker may
+  // not have published the confirmations up to it yet. The player keeps those
+  // for its replay when they arrive after the state, and replays the frames
+  // confirmed after it.
+  state_senders_[request.player_nbr].Start(++last_transfer_id_,
+                                           rollback_.GetConfirmedFrame(),
+                                           rollback_.GetConfirmedGame());
+}
+
+void Application::SendStateChunks() noexcept {
+  if (game_.player_nbr != 0) {
+    return;
+  }
+
+  const auto now = StateTransferSender::Clock::now();
+  std::vector<StateChunk> chunks;
+  for (int player_id = 1; player_id < rollback_.GetPlayerCount();
+       player_id++) {
+    chunks.clear();
+    state_senders_[player_id].GetChunksToSend(now, chunks);
+
+    // Unreliable, the chunks that are not acknowledged are sent again.
+    for (const auto& chunk : chunks) {
+      auto& writer = StartPacket(PacketType::kStateChunk);
+      writer.WriteInt(chunk.transfer_id);
+      writer.WriteInt(chunk.frame_nbr);
+      writer.WriteInt(chunk.chunk_index);
+      writer.WriteInt(chunk.chunk_count);
+      writer.WriteInt(chunk.raw_size);
+      writer.WriteU32(chunk.checksum);
+      const auto* data =
+          reinterpret_cast<const std::uint8_t*>(chunk.data.data());
+      packet::WriteBytes(writer, data, static_cast<int>(chunk.data.size()));
+      SendPacket(false, player_id);
+    }
+  }
+}
+
+void Application::HandleStateChunk(const Packet& packet) noexcept {
+  StateReader reader(packet.data);
+  StateChunk chunk;
+  chunk.transfer_id = reader.ReadInt();
+  chunk.frame_nbr = reader.ReadInt();
+  chunk.chunk_index = reader.ReadInt();
+  chunk.chunk_count = reader.ReadInt();
+  chunk.raw_size = reader.ReadInt();
+  chunk.checksum = reader.ReadU32();
+  const auto data = packet::ReadBytes(reader);
+  if (reader.HasFailed()) {
+    std::cerr << "Invalid state chunk packet\n";
+    return;
+  }
+  chunk.data.assign(data.begin(), data.end());
+
+  if (is_waiting_for_state_ && state_receiver_.AddChunk(chunk)) {
+    last_state_time_ = std::chrono::steady_clock::now();
+  }
+
+  // Acknowledge every chunk received so far, a lost acknowledgment is
+  // covered by the next one.
+  if (chunk.transfer_id == state_receiver_.GetTransferId()) {
+    const auto& received_chunks = state_receiver_.GetReceivedChunks();
+    auto& writer = StartPacket(PacketType::kStateAck);
+    writer.WriteInt(chunk.transfer_id);
+    packet::WriteInts(writer, received_chunks.data(),
+                      static_cast<int>(received_chunks.size()));
+    SendPacket(false, packet.player_nbr);
+  }
+
+  if (is_waiting_for_state_ && state_receiver_.IsComplete()) {
+    RestoreState();
+  }
+}
+
+void Application::RestoreState() noexcept {
+  const int state_frame = state_receiver_.GetFrame();
+  if (!state_receiver_.Load(game_)) {
+    std::cerr << "The state of frame " << state_frame
+              << " received from the master client is not valid.\n";
+    state_receiver_.Reset();
+    SendStateRequest();
+    return;
+  }
+  is_waiting_for_state_ = false;
+  rollback_.RestoreConfirmedState(state_frame, game_);
+  // Our next packets tell the other players we forgot their inputs after the
+  // state.
+  loaded_state_count_++;
+
+  // Our inputs after the state were sent already, schedule them again so the
+  // other players see the same ones.
+  EraseConfirmedInputs(state_frame);
+  for (const auto& frame_input : local_inputs_) {
+    rollback_.SetPlayerInput(frame_input, game_.player_nbr);
+  }
+
+  // The confirmed frames up to the state are not simulated by our
+  // confirmation worker anymore, the replay keeps the ones of the master
+  // client.
+  while (!confirmed_frames_.empty() &&
+         confirmed_frames_.back().frame_nbr > state_frame) {
+    confirmed_frames_.pop_back();
+  }
+  for (const auto& confirmed_frame : pending_confirmations_) {
+    if (confirmed_frame.frame_nbr > state_frame) {
+      if (!ReplayConfirmation(confirmed_frame)) {
+        RequestState();
+        return;
+      }
+    } else {
+      AddRestoredConfirmation(confirmed_frame);
+    }
+  }
+  pending_confirmations_.clear();
+
+  // The inputs received meanwhile that follow the ones we know, without a
+  // gap.
+  for (int player_id = 0; player_id < rollback_.GetPlayerCount();
+       player_id++) {
+    auto& pending_inputs = pending_inputs_[player_id];
+    const int first_frame = rollback_.GetLastInputFrame(player_id) + 1;
+    std::vector<input::FrameInput> frame_inputs;
+    for (auto it = pending_inputs.find(first_frame);
+         it != pending_inputs.end() &&
+         it->first == first_frame + static_cast<int>(frame_inputs.size());
+         ++it) {
+      frame_inputs.push_back({it->second, it->first});
+    }
+    if (!frame_inputs.empty()) {
+      rollback_.SetOtherPlayerInput(frame_inputs, player_id);
+    }
+    pending_inputs.clear();
+  }
+
+  std::cout << "Restored the state of frame " << state_frame
+            << " from the master client\n";
+}
 
-  auto end_it = remote_frame_inputs.end();
+bool Application::ReplayConfirmation(
+    const ConfirmedFrame& confirmed_frame) noexcept {
+  if (confirmed_frame.frame_nbr != rollback_.GetFrameToConfirm()) {
+    std::cerr << "Unexpected frame confirmation: " << confirmed_frame.frame_nbr
+              << '\n';
+    return false;
+  }
+  rollback_.ReplayConfirmedFrame(confirmed_frame);
 
-  // If the last remote inputs is greater than the current frame. The end
-  // iterator must be equal to the frame input of the local current frame.
-  if (remote_frame_inputs.back().frame_nbr > rollback_.GetCurentFrame()) {
-    // Get the iterator of the inputs at the current frame to avoid to confirm
-    // a frame greater than the local current frame.
-    const auto current_frame_it = std::find_if(
-        remote_frame_inputs.begin(), remote_frame_inputs.end(),
-        [this](const input::FrameInput& frame_input) {
-          return frame_input.frame_nbr == rollback_.GetCurentFrame();
-        });
+  // Our checksum of the frame is computed later by the confirmation worker.
+  remote_confirmations_.push(confirmed_frame);
+  EraseConfirmedInputs(confirmed_frame.frame_nbr);
+  return true;
+}
 
-    end_it = current_frame_it;
+void Application::AddRestoredConfirmation(
+    const ConfirmedFrame& confirmed_frame) noexcept {
+  const int next_frame =
+      confirmed_frames_.empty() ? 0 : confirmed_frames_.back().frame_nbr + 1;
+  if (confirmed_frame.frame_nbr == next_frame) {
+    confirmed_frames_.push_back(confirmed_frame);
   }
+}
 
-  while (frame_to_confirm_it != end_it) {
-    const auto frame_to_confirm = *frame_to_confirm_it;
+void Application::SaveReplay() noexcept {
+  Replay replay;
+  replay.player_count = game_.GetPlayerCount();
+  replay.ball_type = game_.GetBallType();
+  replay.player_nbr = game_.player_nbr;
 
-    if (frame_to_confirm.frame_nbr > rollback_.GetCurentFrame()) {
-      // Tried to confirm a frame greater than the local current frame.
+  for (const auto& confirmed_frame : confirmed_frames_) {
+    if (!replay.AddFrame(confirmed_frame)) {
       break;
     }
+  }
+
+  const auto path = "replay_" + std::to_string(std::time(nullptr)) +
+                    "_player" + std::to_string(game_.player_nbr) + ".bin";
+  if (!replay.Save(path)) {
+    std::cerr << "Could not write the replay " << path << '\n';
+  }
+}
+
+ConfirmedFrame Application::ReadConfirmedFrame(
+    const Packet& packet) const noexcept {
+  StateReader reader(packet.data);
+  ConfirmedFrame confirmed_frame{};
+  confirmed_frame.frame_nbr = reader.ReadInt();
+  confirmed_frame.checksum = reader.ReadInt();
+  confirmed_frame.merkle_root = reader.ReadU32();
+  const auto inputs = packet::ReadBytes(reader);
+  if (reader.HasFailed() ||
+      static_cast<int>(inputs.size()) < game_.GetPlayerCount() ||
+      inputs.size() > confirmed_frame.inputs.size()) {
+    // Not a valid confirmation.
+    confirmed_frame.frame_nbr = -1;
+    return confirmed_frame;
+  }
+  std::copy(inputs.begin(), inputs.end(), confirmed_frame.inputs.begin());
+  return confirmed_frame;
+}
+
+void Application::ReceivePackets() {
+  auto& transport = network_.GetTransport();
+  while (transport.Receive(received_packet_)) {
+    Packet packet;
+    if (!packet::Decode(received_packet_, packet)) {
+      std::cerr << "Unknown packet from player " << received_packet_.peer
+                << '\n';
+      continue;
+    }
+    packet_queue.push(std::move(packet));
+  }
+}
+
+StateWriter& Application::StartPacket(PacketType type) noexcept {
+  packet_writer_.Clear();
+  packet::WriteType(packet_writer_, type);
+  return packet_writer_;
+}
+
+void Application::SendPacket(bool reliable, int player_nbr) noexcept {
+  auto& transport = network_.GetTransport();
+  if (reliable) {
+    transport.SendReliable(player_nbr, packet_writer_.GetData(),
+                           packet_writer_.GetSize());
+  } else {
+    transport.SendUnreliable(player_nbr, packet_writer_.GetData(),
+                             packet_writer_.GetSize());
+  }
+}
+
+void Application::EraseConfirmedInputs(int confirmed_frame) noexcept {
+  // Every player receives the confirmed inputs with the frame confirmation,
+  // they do not need to be sent anymore.
+  while (!local_inputs_.empty() &&
+         local_inputs_.front().frame_nbr <= confirmed_frame) {
+    local_inputs_.pop_front();
+  }
+}
+
+void Application::SendInputs() noexcept {
+  // The inputs after the oldest frame acknowledged by the other players.
+  int acked_frame = std::numeric_limits<int>::max();
+  for (int player_id = 0; player_id < rollback_.GetPlayerCount();
+       player_id++) {
+    if (player_id != game_.player_nbr) {
+      acked_frame = std::min(acked_frame, input_acks_[player_id].acked_frame);
+    }
+  }
+  const auto first_unacked = std::partition_point(
+      local_inputs_.cbegin(), local_inputs_.cend(),
+      [acked_frame](const input::FrameInput& frame_input) {
+        return frame_input.frame_nbr <= acked_frame;
+      });
 
-    const int check_sum = rollback_.ConfirmFrame();
+  const auto window_begin =
+      local_inputs_.cend() - first_unacked > metrics::kInputRedundancy
+          ? local_inputs_.cend() - metrics::kInputRedundancy
+          : first_unacked;
 
-    ExitGames::Common::Hashtable event_check_sum;
-    event_check_sum.put(static_cast<nByte>(PacketKey::kChecksum), check_sum);
-    event_check_sum.put(static_cast<nByte>(PacketKey::kInput), inputs_.data(),
-                        inputs_.size());
-    event_check_sum.put(static_cast<nByte>(PacketKey::kFrame), frames_.data(),
-                        frames_.size());
+  // The inputs that left the window before being acknowledged, after a loss
+  // or a latency spike, are not sent again unreliably.
+  const auto reliable_begin = std::partition_point(
+      first_unacked, window_begin,
+      [this](const input::FrameInput& frame_input) {
+        return frame_input.frame_nbr <= reliable_input_frame_;
+      });
+  if (reliable_begin != window_begin) {
+    WriteInputPacket(reliable_begin, window_begin);
+    SendPacket(true);
+    reliable_input_frame_ = std::prev(window_begin)->frame_nbr;
+  }
 
-    network_.RaiseEvent(true, PacketType::kFrameConfirmation, event_check_sum);
+  // Sent even without inputs, it carries our acknowledgments and frame.
+  WriteInputPacket(window_begin, local_inputs_.cend());
+  SendPacket(false);
+}
+
+void Application::WriteInputPacket(
+    std::deque<input::FrameInput>::const_iterator begin,
+    std::deque<input::FrameInput>::const_iterator end) {
+  std::array<int, metrics::kMaxPlayerNbr> advantages{};
+  std::array<int, metrics::kMaxPlayerNbr> acked_frames{};
+  for (int player_id = 0; player_id < rollback_.GetPlayerCount();
+       player_id++) {
+    advantages[player_id] = time_sync_.GetLocalAdvantage(player_id);
+    // Includes the inputs kept ahead of the current frame, they are not sent
+    // again.
+    acked_frames[player_id] = rollback_.GetLastInputFrame(player_id);
+  }
 
-    ++frame_to_confirm_it;
+  auto& writer = StartPacket(PacketType::kInput);
+  writer.WriteInt(rollback_.GetCurentFrame());
+  writer.WriteInt(loaded_state_count_);
+  packet::WriteInts(writer, advantages.data(), rollback_.GetPlayerCount());
+  packet::WriteInts(writer, acked_frames.data(), rollback_.GetPlayerCount());
+
+  // The inputs follow each other, only the frame of the first one is sent.
+  writer.WriteInt(begin != end ? begin->frame_nbr : 0);
+  writer.WriteInt(static_cast<int>(end - begin));
+  for (auto it = begin; it != end; ++it) {
+    writer.WriteU8(it->input);
   }
 }
@@ -0,0 +1,94 @@
+#include "checksum.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CHECKSUM_HAS_SSE42
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CHECKSUM_TARGET_SSE42
+#else
+#define CHECKSUM_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#endif
+
+namespace checksum {
+
+namespace {
+
+// The reversed Castagnoli polynomial.
+constexpr std::uint32_t kPolynomial = 0x82F63B78;
+
+constexpr std::array<std::uint32_t, 256> kTable = [] {
+  std::array<std::uint32_t, 256> table{};
+  for (std::uint32_t byte = 0; byte < 256; byte++) {
+    std::uint32_t crc = byte;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ ((crc & 1) ? kPolynomial : 0);
+    }
+    table[byte] = crc;
+  }
+  return table;
+}();
+
+std::uint32_t Crc32cSoftware(const std::uint8_t* bytes, std::size_t size,
+                             std::uint32_t crc) noexcept {
+  for (std::size_t i = 0; i < size; i++) {
+    crc = kTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#ifdef CHECKSUM_HAS_SSE42
+CHECKSUM_TARGET_SSE42 std::uint32_t Crc32cHardware(const std::uint8_t* bytes,
+                                                   std::size_t size,
+                                                   std::uint32_t crc) noexcept {
+  std::uint64_t crc64 = crc;
+  while (size >= sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+    bytes += sizeof(word);
+    size -= sizeof(word);
+  }
+
+  auto crc32 = static_cast<std::uint32_t>(crc64);
+  while (size > 0) {
+    crc32 = _mm_crc32_u8(crc32, *bytes);
+    bytes++;
+    size--;
+  }
+  return crc32;
+}
+
+bool IsSse42Supported() noexcept {
+#ifdef _MSC_VER
+  int cpu_info[4];
+  __cpuid(cpu_info, 1);
+  return (cpu_info[2] & (1 << 20)) != 0;
+#else
+  return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif
+
+}  // namespace
+
+std::uint32_t Crc32c(const void* data, std::size_t size,
+                     std::uint32_t crc) noexcept {
+  const auto* bytes = static_cast<const std::uint8_t*>(data);
+  crc = ~crc;
+
+#ifdef CHECKSUM_HAS_SSE42
+  static const bool is_sse42_supported = IsSse42Supported();
+  if (is_sse42_supported) {
+    return ~Crc32cHardware(bytes, size, crc);
+  }
+#endif
+
+  return ~Crc32cSoftware(bytes, size, crc);
+}
+
+}  // namespace checksum
@@ -0,0 +1,135 @@
+#include "confirmation_worker.h"
+
+#include <chrono>
+#include <utility>
+
+#ifdef TRACY_ENABLE
+#include <Tracy.hpp>
+#endif
+
+void ConfirmationWorker::Start(int player_count, BallType ball_type) {
+  Clear();
+
+  player_count_ = player_count;
+  // Assigning a new game would leave the quad tree nodes with the allocator
+  // of the temporary game, restart it instead.
+  game_.Restart();
+  game_.SetBallType(ball_type);
+  game_.SetPlayerCount(player_count);
+  game_.StartGame();
+  // Only the checksum of the confirmed game is observed.
+  game_.SetResimulating(true);
+
+  is_running_.store(true, std::memory_order_release);
+  thread_ = std::thread(&ConfirmationWorker::Loop, this);
+}
+
+void ConfirmationWorker::Start(const Game& state) {
+  Clear();
+
+  player_count_ = state.GetPlayerCount();
+  game_.Copy(state);
+  game_.SetResimulating(true);
+
+  is_running_.store(true, std::memory_order_release);
+  thread_ = std::thread(&ConfirmationWorker::Loop, this);
+}
+
+void ConfirmationWorker::Stop() noexcept {
+  is_running_.store(false, std::memory_order_release);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void ConfirmationWorker::PushFrame(const ConfirmedFrame& frame) noexcept {
+  while (!frames_.TryPush(frame)) {
+    std::this_thread::yield();
+  }
+}
+
+void ConfirmationWorker::Clear() noexcept {
+  Stop();
+
+  // Drop what is left from the previous timeline.
+  ConfirmedFrame frame{};
+  while (frames_.TryPop(frame)) {
+  }
+  while (checksums_.TryPop(frame)) {
+  }
+  pending_checksums_.clear();
+  merkle_tree_frames_.Fill(-1);
+}
+
+void ConfirmationWorker::FlushChecksums() noexcept {
+  while (!pending_checksums_.empty() &&
+         checksums_.TryPush(pending_checksums_.front())) {
+    pending_checksums_.pop_front();
+  }
+}
+
+bool ConfirmationWorker::CopyMerkleTree(int frame_nbr,
+                                        MerkleTree& tree) const {
+  std::lock_guard<std::mutex> lock(merkle_mutex_);
+  if (frame_nbr < 0 || merkle_tree_frames_[frame_nbr] != frame_nbr) {
+    return false;
+  }
+  tree = merkle_trees_[frame_nbr];
+  return true;
+}
+
+bool ConfirmationWorker::CopyState(int frame_nbr,
+                                   std::vector<std::uint8_t>& state) const {
+  std::lock_guard<std::mutex> lock(merkle_mutex_);
+  if (frame_nbr < 0 || merkle_tree_frames_[frame_nbr] != frame_nbr) {
+    return false;
+  }
+  state = states_[frame_nbr];
+  return true;
+}
+
+void ConfirmationWorker::Loop() noexcept {
+  // Confirmations come at most once per fixed update, there is no need to
+  // poll the queue faster than that.
+  constexpr auto kIdleDuration = std::chrono::milliseconds(1);
+
+  ConfirmedFrame frame{};
+
+  while (is_running_.load(std::memory_order_acquire)) {
+    FlushChecksums();
+    if (!frames_.TryPop(frame)) {
+      std::this_thread::sleep_for(kIdleDuration);
+      continue;
+    }
+
+#ifdef TRACY_ENABLE
+    ZoneScopedN("ConfirmFrame");
+#endif
+    for (int player_id = 0; player_id < player_count_; player_id++) {
+      game_.SetPlayerInput(player_id, frame.inputs[player_id]);
+    }
+
+    game_.FixedUpdate();
+    frame.checksum = game_.CheckSum();
+
+    game_.ComputeEntityHashes(merkle_tree_);
+    frame.merkle_root = merkle_tree_.GetRoot();
+
+    // The state that was hashed goes in the desync dumps.
+    state_writer_.Clear();
+    game_.Serialize(state_writer_);
+    state_.assign(state_writer_.GetData(),
+                  state_writer_.GetData() + state_writer_.GetSize());
+    {
+      // Swap instead of copying, the old tree and state are reused for the
+      // next frame.
+      std::lock_guard<std::mutex> lock(merkle_mutex_);
+      std::swap(merkle_trees_[frame.frame_nbr], merkle_tree_);
+      std::swap(states_[frame.frame_nbr], state_);
+      merkle_tree_frames_[frame.frame_nbr] = frame.frame_nbr;
+    }
+
+    // Published by the next iteration, after the checksums still pending.
+    pending_checksums_.push_back(frame);
+  }
+}
@@ -0,0 +1,86 @@
+#include "desync_dump.h"
+
+#include <fstream>
+#include <iterator>
+
+#include "state_reader.h"
+#include "state_writer.h"
+
+bool DesyncDump::Save(const std::string& path) const {
+  StateWriter writer;
+  writer.WriteU32(kMagic);
+  writer.WriteU32(kVersion);
+
+  writer.WriteInt(player_count);
+  writer.WriteU8(static_cast<std::uint8_t>(ball_type));
+  writer.WriteInt(player_nbr);
+  writer.WriteInt(frame_nbr);
+
+  writer.WriteU32(static_cast<std::uint32_t>(state.size()));
+  for (const auto byte : state) {
+    writer.WriteU8(byte);
+  }
+
+  writer.WriteU32(static_cast<std::uint32_t>(confirmed_frames.size()));
+  for (const auto& confirmed_frame : confirmed_frames) {
+    writer.WriteInt(confirmed_frame.frame_nbr);
+    for (int player_id = 0; player_id < player_count; player_id++) {
+      writer.WriteU8(confirmed_frame.inputs[player_id]);
+    }
+    writer.WriteInt(confirmed_frame.checksum);
+    writer.WriteU32(confirmed_frame.merkle_root);
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(writer.GetData()),
+             static_cast<std::streamsize>(writer.GetSize()));
+  return file.good();
+}
+
+bool DesyncDump::Load(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  const std::vector<std::uint8_t> data(std::istreambuf_iterator<char>(file),
+                                       {});
+
+  StateReader reader(data);
+  if (reader.ReadU32() != kMagic || reader.ReadU32() != kVersion) {
+    return false;
+  }
+
+  player_count = reader.ReadInt();
+  ball_type = static_cast<BallType>(reader.ReadU8());
+  player_nbr = reader.ReadInt();
+  frame_nbr = reader.ReadInt();
+  if (player_count < metrics::kMinPlayerNbr ||
+      player_count > metrics::kMaxPlayerNbr) {
+    return false;
+  }
+
+  const auto state_size = reader.ReadU32();
+  if (state_size > reader.GetRemainingSize()) {
+    return false;
+  }
+  state.resize(state_size);
+  for (auto& byte : state) {
+    byte = reader.ReadU8();
+  }
+
+  const auto frame_count = reader.ReadU32();
+  if (frame_count > reader.GetRemainingSize()) {
+    return false;
+  }
+  confirmed_frames.resize(frame_count);
+  for (auto& confirmed_frame : confirmed_frames) {
+    confirmed_frame.frame_nbr = reader.ReadInt();
+    for (int player_id = 0; player_id < player_count; player_id++) {
+      confirmed_frame.inputs[player_id] = reader.ReadU8();
+    }
+    confirmed_frame.checksum = reader.ReadInt();
+    confirmed_frame.merkle_root = reader.ReadU32();
+  }
+
+  return !reader.HasFailed();
+}
@@ -0,0 +1,46 @@
+#include "input_delay.h"
+
+#include <algorithm>
+#include <cmath>
+
+void InputDelay::SetBounds(int min_delay, int max_delay) noexcept {
+  min_delay_ = std::clamp(min_delay, 0, metrics::kMaxRollbackFrames / 2);
+  max_delay_ =
+      std::clamp(max_delay, min_delay_, metrics::kMaxRollbackFrames / 2);
+  delay_ = std::clamp(delay_, min_delay_, max_delay_);
+  target_delay_ = std::clamp(target_delay_, min_delay_, max_delay_);
+  stable_frames_ = 0;
+}
+
+void InputDelay::Update(int round_trip_time, int jitter) noexcept {
+  // The inputs are relayed by the server, so an input of the other player
+  // arrives after half of its round trip plus half of ours. Both are assumed
+  // to be the same, with a margin for the jitter.
+  constexpr float kFrameTime = metrics::kFixedDeltaTime * 1000.f;
+  const float latency =
+      static_cast<float>(round_trip_time) + 2.f * static_cast<float>(jitter);
+  target_delay_ = std::clamp(static_cast<int>(std::ceil(latency / kFrameTime)),
+                             min_delay_, max_delay_);
+
+  if (target_delay_ > delay_) {
+    stable_frames_ = std::max(stable_frames_, 0) + 1;
+  } else if (target_delay_ < delay_) {
+    stable_frames_ = std::min(stable_frames_, 0) - 1;
+  } else {
+    stable_frames_ = 0;
+  }
+
+  if (stable_frames_ >= kStableFrames) {
+    delay_++;
+    stable_frames_ = 0;
+  } else if (stable_frames_ <= -kStableFrames) {
+    delay_--;
+    stable_frames_ = 0;
+  }
+}
+
+void InputDelay::Reset() noexcept {
+  delay_ = min_delay_;
+  target_delay_ = min_delay_;
+  stable_frames_ = 0;
+}
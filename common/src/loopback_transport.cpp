@@ -0,0 +1,66 @@
+#include "loopback_transport.h"
+
+#include <utility>
+
+void LoopbackTransport::SendUnreliable(int peer, const std::uint8_t* data,
+                                       std::size_t size) {
+  network_->Send(peer_, peer, data, size, false);
+}
+
+void LoopbackTransport::SendReliable(int peer, const std::uint8_t* data,
+                                     std::size_t size) {
+  network_->Send(peer_, peer, data, size, true);
+}
+
+bool LoopbackTransport::Receive(TransportPacket& packet) {
+  if (received_.empty()) {
+    return false;
+  }
+
+  auto& received = received_.front();
+  packet.peer = received.peer;
+  std::swap(packet.data, received.data);
+  // The previous buffer of the caller is kept for a next packet.
+  if (received.data.capacity() > 0) {
+    received.data.clear();
+    network_->free_buffers_.push_back(std::move(received.data));
+  }
+  received_.pop_front();
+  return true;
+}
+
+LoopbackNetwork::LoopbackNetwork(int peer_count, unsigned int seed)
+    : random_engine_(seed) {
+  transports_.reserve(peer_count);
+  for (int peer = 0; peer < peer_count; peer++) {
+    transports_.push_back(std::make_unique<LoopbackTransport>(this, peer));
+  }
+}
+
+void LoopbackNetwork::Send(int sender, int receiver, const std::uint8_t* data,
+                           std::size_t size, bool is_reliable) {
+  std::uniform_real_distribution<float> loss_distribution(0.f, 1.f);
+  for (int peer = 0; peer < GetPeerCount(); peer++) {
+    if (peer == sender ||
+        (receiver != Transport::kAllPeers && peer != receiver)) {
+      continue;
+    }
+    if (!is_reliable && loss_rate_ > 0.f &&
+        loss_distribution(random_engine_) < loss_rate_) {
+      continue;
+    }
+    Deliver(sender, peer, data, size);
+  }
+}
+
+void LoopbackNetwork::Deliver(int sender, int receiver,
+                              const std::uint8_t* data, std::size_t size) {
+  TransportPacket packet;
+  packet.peer = sender;
+  if (!free_buffers_.empty()) {
+    packet.data = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+  }
+  packet.data.assign(data, data + size);
+  transports_[receiver]->received_.push_back(std::move(packet));
+}
@@ -0,0 +1,62 @@
+#include "merkle_tree.h"
+
+#include "checksum.h"
+
+void MerkleTree::Clear() noexcept {
+  leaves_.clear();
+  leaf_hashes_.clear();
+}
+
+void MerkleTree::AddLeaf(EntityKind kind, int entity_index,
+                         std::uint32_t hash) {
+  leaves_.push_back({kind, entity_index});
+  leaf_hashes_.push_back(hash);
+}
+
+void MerkleTree::Build() {
+  leaf_count_ = 1;
+  while (leaf_count_ < static_cast<int>(leaves_.size())) {
+    leaf_count_ *= 2;
+  }
+
+  leaves_.resize(leaf_count_);
+  leaf_hashes_.resize(leaf_count_, 0);
+
+  nodes_.resize(2 * leaf_count_);
+  for (int leaf = 0; leaf < leaf_count_; leaf++) {
+    nodes_[leaf_count_ + leaf] = leaf_hashes_[leaf];
+  }
+
+  // Each inner node hashes the hashes of its two children, in little endian.
+  for (int node = leaf_count_ - 1; node >= kRootNode; node--) {
+    std::uint8_t children[8];
+    for (int byte = 0; byte < 4; byte++) {
+      children[byte] =
+          static_cast<std::uint8_t>(nodes_[2 * node] >> (8 * byte));
+      children[4 + byte] =
+          static_cast<std::uint8_t>(nodes_[2 * node + 1] >> (8 * byte));
+    }
+    nodes_[node] = checksum::Crc32c(children, sizeof(children));
+  }
+}
+
+std::string MerkleTree::DescribeLeaf(int node) const {
+  const auto& leaf = leaves_[node - leaf_count_];
+  const auto index = std::to_string(leaf.entity_index);
+
+  switch (leaf.kind) {
+    case EntityKind::kBody:
+      return "body " + index;
+    case EntityKind::kCollider:
+      return "collider " + index;
+    case EntityKind::kContacts:
+      return "contacts";
+    case EntityKind::kPlayer:
+      return "player " + index;
+    case EntityKind::kScores:
+      return "scores";
+    case EntityKind::kPadding:
+      break;
+  }
+  return "padding";
+}
@@ -18,16 +18,50 @@ void Network::Connect() {
     EGLOG(ExitGames::Common::DebugLevel::ERRORS, L"Could not Connect.");
 }
 
-void Network::Service() { load_balancing_client_.service(); }
+void Network::Service() { transport_.Service(); }
+
+namespace {
+
+// The room property telling whether the game started, the players only join
+// the rooms where it did not and the spectators the rooms where it did.
+const ExitGames::Common::JString kStartedProperty = L"started";
+
+ExitGames::Common::Hashtable MakeStartedProperty(bool is_started) {
+  ExitGames::Common::Hashtable properties;
+  properties.put(kStartedProperty, is_started);
+  return properties;
+}
+
+}  // namespace
 
 void Network::JoinRandomOrCreateRoom() noexcept {
+  is_spectator_ = false;
+
   const auto game_id = ExitGames::Common::JString();
-  const ExitGames::LoadBalancing::RoomOptions room_options(true, true, 2);
-  if (!load_balancing_client_.opJoinRandomOrCreateRoom(game_id, room_options))
+  const auto not_started = MakeStartedProperty(false);
+  ExitGames::Common::JVector<ExitGames::Common::JString> lobby_properties;
+  lobby_properties.addElement(kStartedProperty);
+
+  ExitGames::LoadBalancing::RoomOptions room_options(
+      true, true, GetRoomSize(), not_started, lobby_properties);
+  // A player who loses the connection can rejoin the game and get its state
+  // back from the master client.
+  room_options.setPlayerTtl(kPlayerTtl);
+  if (!load_balancing_client_.opJoinRandomOrCreateRoom(
+          game_id, room_options, not_started, GetRoomSize()))
     EGLOG(ExitGames::Common::DebugLevel::ERRORS,
           L"Could not join or create room.");
 }
 
+void Network::JoinAsSpectator() noexcept {
+  is_spectator_ = true;
+
+  if (!load_balancing_client_.opJoinRandomRoom(MakeStartedProperty(true),
+                                               GetRoomSize()))
+    EGLOG(ExitGames::Common::DebugLevel::ERRORS,
+          L"Could not join a room as spectator.");
+}
+
 void Network::LeaveRoom() noexcept { load_balancing_client_.opLeaveRoom(); }
 
 void Network::Disconnect() {
@@ -36,24 +70,6 @@ void Network::Disconnect() {
                       // arrives in the Network::disconnectReturn() callback
 }
 
-void Network::RaiseEvent(bool reliable, PacketType type,
-                         const ExitGames::Common::Hashtable& data) noexcept {
-  if (!load_balancing_client_.opRaiseEvent(reliable, data,
-                                           static_cast<nByte>(type))) {
-    EGLOG(ExitGames::Common::DebugLevel::ERRORS, L"Could not raise event.");
-  }
-}
-
-void Network::ReceiveEvent(int player_nr, PacketType type,
-                           const ExitGames::Common::Hashtable& data) noexcept {
-  EGLOG(ExitGames::Common::DebugLevel::ALL,
-        L"an event of type %d from player Nr %d with the following content has "
-        L"just arrived: %ls",
-        static_cast<nByte>(type), player_nr, data.toString(true).cstr());
-
-  app_->packet_queue.push({type, data});
-}
-
 void Network::debugReturn(int debugLevel,
                           const ExitGames::Common::JString& string) {
   std::cout << "debug return: debug level: " << debugLevel
@@ -62,6 +78,13 @@ void Network::debugReturn(int debugLevel,
 
 void Network::connectionErrorReturn(int errorCode) {
   std::cout << "error connection\n";
+
+  // Go back to the game in progress, the master client sends its state once
+  // the room is joined again.
+  if (!is_spectator_ && game_->GetState() == GameState::kInGame &&
+      !load_balancing_client_.reconnectAndRejoin()) {
+    EGLOG(ExitGames::Common::DebugLevel::ERRORS, L"Could not rejoin the room.");
+  }
 }
 
 void Network::clientErrorReturn(int errorCode) {
@@ -82,12 +105,36 @@ void Network::joinRoomEventAction(
   if (game_->player_nbr == -1) {
     game_->player_nbr = playerNr - 1;
   }
-  if (playerNr == 2) {
+  if (game_->GetState() == GameState::kInGame && !is_spectator_) {
+    // A player rejoined the game in progress, it is not started again. The
+    // one who rejoined asks for the confirmed state it missed.
+    if (playerNr - 1 == game_->player_nbr) {
+      app_->RequestState();
+    }
+  } else if (is_spectator_) {
+    // The game already started, the spectator plays it from the confirmed
+    // frames cached by the room.
+    if (playerNr - 1 == game_->player_nbr) {
+      game_->SetBallType(BallType::kBasketball);
+      game_->SetPlayerCount(player_count_);
+
+      game_->StartGame();
+      app_->StartSpectating();
+      renderer_->StartGame();
+    }
+  } else if (playerNr == player_count_) {
     game_->SetBallType(BallType::kBasketball);
+    game_->SetPlayerCount(player_count_);
 
     game_->StartGame();
     rollback_->RegisterGame(game_);
     renderer_->StartGame();
+
+    // The room is still open to the spectators but not to the players.
+    if (game_->player_nbr == 0) {
+      load_balancing_client_.getCurrentlyJoinedRoom().mergeCustomProperties(
+          MakeStartedProperty(true));
+    }
   }
 
   std::cout << "Room state: player nr: " << playerNr
@@ -102,15 +149,13 @@ void Network::leaveRoomEventAction(int playerNr, bool isInactive) {
 
 void Network::customEventAction(int playerNr, nByte eventCode,
                                 const ExitGames::Common::Object& eventContent) {
-  if (eventContent.getType() != ExitGames::Common::TypeCode::HASHTABLE) {
-    std::cerr << "Unsupported event content type \n";
+  if (eventCode != PhotonTransport::kEventCode) {
+    std::cerr << "Unsupported event code " << static_cast<int>(eventCode)
+              << '\n';
     return;
   }
-
-  const ExitGames::Common::Hashtable& data =
-      ExitGames::Common::ValueObject<ExitGames::Common::Hashtable>(eventContent)
-          .getDataCopy();
-  ReceiveEvent(playerNr, static_cast<PacketType>(eventCode), data);
+  // The actor numbers of the room start at 1.
+  transport_.OnEvent(playerNr - 1, eventContent);
 }
 
 void Network::connectReturn(int errorCode,
@@ -141,4 +186,19 @@ void Network::joinRandomOrCreateRoomReturn(
   ExitGames::LoadBalancing::Listener::joinRandomOrCreateRoomReturn(
       i, hashtable, hashtable1, i1, string);
   std::cout << "Joined or created a room\n";
-}
\ No newline at end of file
+}
+
+void Network::joinRandomRoomReturn(
+    int i, const ExitGames::Common::Hashtable& hashtable,
+    const ExitGames::Common::Hashtable& hashtable1, int error_code,
+    const ExitGames::Common::JString& string) {
+  if (error_code != 0) {
+    // No game to watch, go back to the menu.
+    std::cout << "No room to spectate: "
+              << string.UTF8Representation().cstr() << '\n';
+    is_spectator_ = false;
+    renderer_->CancelWaiting();
+    return;
+  }
+  std::cout << "Joined a room as spectator\n";
+}
@@ -0,0 +1,61 @@
+#include "packet.h"
+
+namespace packet {
+
+void WriteType(StateWriter& writer, PacketType type) {
+  writer.WriteU8(static_cast<std::uint8_t>(type));
+}
+
+bool Decode(const TransportPacket& transport_packet, Packet& packet) {
+  const auto& data = transport_packet.data;
+  if (data.empty() ||
+      data[0] > static_cast<std::uint8_t>(PacketType::kStateAck)) {
+    return false;
+  }
+  packet.type = static_cast<PacketType>(data[0]);
+  packet.data.assign(data.begin() + 1, data.end());
+  packet.player_nbr = transport_packet.peer;
+  return true;
+}
+
+void WriteInts(StateWriter& writer, const int* values, int count) {
+  writer.WriteInt(count);
+  for (int i = 0; i < count; i++) {
+    writer.WriteInt(values[i]);
+  }
+}
+
+void WriteBytes(StateWriter& writer, const std::uint8_t* values, int count) {
+  writer.WriteInt(count);
+  for (int i = 0; i < count; i++) {
+    writer.WriteU8(values[i]);
+  }
+}
+
+std::vector<int> ReadInts(StateReader& reader) {
+  const auto count = reader.ReadU32();
+  if (count > reader.GetRemainingSize() / sizeof(std::uint32_t)) {
+    reader.SetFailed();
+    return {};
+  }
+  std::vector<int> values(count);
+  for (auto& value : values) {
+    value = reader.ReadInt();
+  }
+  return values;
+}
+
+std::vector<std::uint8_t> ReadBytes(StateReader& reader) {
+  const auto count = reader.ReadU32();
+  if (count > reader.GetRemainingSize()) {
+    reader.SetFailed();
+    return {};
+  }
+  std::vector<std::uint8_t> values(count);
+  for (auto& value : values) {
+    value = reader.ReadU8();
+  }
+  return values;
+}
+
+}  // namespace packet
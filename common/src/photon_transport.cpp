@@ -0,0 +1,91 @@
+#include "photon_transport.h"
+
+#include <iostream>
+#include <utility>
+
+void PhotonTransport::SendUnreliable(int peer, const std::uint8_t* data,
+                                     std::size_t size) {
+  RaiseEvent(false, peer, data, size, false);
+}
+
+void PhotonTransport::SendReliable(int peer, const std::uint8_t* data,
+                                   std::size_t size) {
+  RaiseEvent(true, peer, data, size, false);
+}
+
+void PhotonTransport::SendCached(const std::uint8_t* data, std::size_t size) {
+  RaiseEvent(true, kAllPeers, data, size, true);
+}
+
+bool PhotonTransport::Receive(TransportPacket& packet) {
+  if (received_packets_.empty()) {
+    return false;
+  }
+  auto& received = received_packets_.front();
+  packet.peer = received.peer;
+  std::swap(packet.data, received.data);
+  // The previous buffer of the caller is kept for a next packet.
+  if (received.data.capacity() > 0) {
+    free_buffers_.push_back(std::move(received.data));
+  }
+  received_packets_.pop_front();
+  return true;
+}
+
+void PhotonTransport::OnEvent(int player_nbr,
+                              const ExitGames::Common::Object& content) {
+  if (content.getType() != ExitGames::Common::TypeCode::BYTE ||
+      content.getDimensions() != 1) {
+    std::cerr << "Unsupported event content type \n";
+    return;
+  }
+
+  // The array is read in place, it is copied once in the packet.
+  const ExitGames::Common::ValueObject<nByte*> value(content);
+  const nByte* data = *value.getDataAddress();
+  const int size = *value.getSizes();
+
+  auto& packet = received_packets_.emplace_back();
+  packet.peer = player_nbr;
+  if (!free_buffers_.empty()) {
+    packet.data = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+  }
+  packet.data.assign(data, data + size);
+}
+
+void PhotonTransport::Clear() noexcept {
+  while (!received_packets_.empty()) {
+    free_buffers_.push_back(std::move(received_packets_.front().data));
+    received_packets_.pop_front();
+  }
+}
+
+void PhotonTransport::RaiseEvent(bool reliable, int peer,
+                                 const std::uint8_t* data, std::size_t size,
+                                 bool is_cached) {
+  ExitGames::LoadBalancing::RaiseEventOptions options;
+  if (is_cached) {
+    options.setEventCaching(ExitGames::Lite::EventCache::ADD_TO_ROOM_CACHE);
+  }
+  if (peer != kAllPeers) {
+    // The actor numbers of the room start at 1.
+    player_actor_nbrs_[0] = peer + 1;
+    options.setTargetPlayers(player_actor_nbrs_.data(), 1);
+  } else if (!is_cached) {
+    // The spectators join after the players, their actor numbers follow the
+    // ones of the players. They only need the cached confirmations.
+    const int local_actor_nbr = client_.getLocalPlayer().getNumber();
+    short target_count = 0;
+    for (int actor_nbr = 1; actor_nbr <= player_count_; actor_nbr++) {
+      if (actor_nbr != local_actor_nbr) {
+        player_actor_nbrs_[target_count++] = actor_nbr;
+      }
+    }
+    options.setTargetPlayers(player_actor_nbrs_.data(), target_count);
+  }
+  if (!client_.opRaiseEvent(reliable, static_cast<const nByte*>(data),
+                            static_cast<int>(size), kEventCode, options)) {
+    std::cerr << "Could not raise event.\n";
+  }
+}
@@ -0,0 +1,171 @@
+#include "prediction.h"
+
+#include <algorithm>
+
+void PredictionStrategy::Observe(int player_id, input::Input input) noexcept {
+  observed_frames_[player_id]++;
+
+  const input::Input changed_bits = input ^ last_observed_inputs_[player_id];
+  for (int bit = 0; bit < input::kBitCount; bit++) {
+    if ((changed_bits >> bit) & 1) {
+      bit_change_counts_[player_id][bit]++;
+    }
+  }
+  last_observed_inputs_[player_id] = input;
+
+  OnObserve(player_id, input);
+}
+
+void PredictionStrategy::Reset() noexcept {
+  observed_frames_.fill(0);
+  hit_count_ = 0;
+  miss_count_ = 0;
+  rollback_count_ = 0;
+  rollback_depth_sum_ = 0;
+  for (auto& player_counts : bit_change_counts_) {
+    player_counts.fill(0);
+  }
+  last_observed_inputs_.fill(0);
+}
+
+void PredictionStrategy::RecordPrediction(bool is_hit) noexcept {
+  if (is_hit) {
+    hit_count_++;
+  } else {
+    miss_count_++;
+  }
+}
+
+void PredictionStrategy::RecordRollback(int depth) noexcept {
+  rollback_count_++;
+  rollback_depth_sum_ += depth;
+}
+
+float PredictionStrategy::GetHitRate() const noexcept {
+  const auto prediction_count = hit_count_ + miss_count_;
+  if (prediction_count == 0) {
+    return 1.f;
+  }
+  return static_cast<float>(hit_count_) / static_cast<float>(prediction_count);
+}
+
+float PredictionStrategy::GetMispredictionsPerSecond() const noexcept {
+  // Every remote player is observed once per frame, the frames are counted
+  // once whatever the number of players.
+  const auto frame_count =
+      *std::max_element(observed_frames_.begin(), observed_frames_.end());
+  if (frame_count == 0) {
+    return 0.f;
+  }
+  const float seconds =
+      static_cast<float>(frame_count) * metrics::kFixedDeltaTime;
+  return static_cast<float>(miss_count_) / seconds;
+}
+
+float PredictionStrategy::GetAverageRollbackDepth() const noexcept {
+  if (rollback_count_ == 0) {
+    return 0.f;
+  }
+  return static_cast<float>(rollback_depth_sum_) /
+         static_cast<float>(rollback_count_);
+}
+
+std::array<int, input::kBitCount> PredictionStrategy::GetBitsByChangeCount(
+    int player_id) const noexcept {
+  std::array<int, input::kBitCount> bits{};
+  for (int bit = 0; bit < input::kBitCount; bit++) {
+    bits[bit] = bit;
+  }
+
+  const auto& counts = bit_change_counts_[player_id];
+  std::stable_sort(bits.begin(), bits.end(), [&counts](int lhs, int rhs) {
+    return counts[lhs] > counts[rhs];
+  });
+
+  return bits;
+}
+
+input::Input RepeatLastPrediction::Predict(
+    int player_id, input::Input last_input, int frames_ahead) const noexcept {
+  return last_input;
+}
+
+input::Input ReleaseJumpPrediction::Predict(
+    int player_id, input::Input last_input, int frames_ahead) const noexcept {
+  if (frames_ahead > release_frames_) {
+    return last_input & ~input::kJump;
+  }
+  return last_input;
+}
+
+input::Input HoldDurationPrediction::Predict(
+    int player_id, input::Input last_input, int frames_ahead) const noexcept {
+  input::Input prediction = 0;
+
+  for (int bit = 0; bit < kInputBitCount; bit++) {
+    const int state = (last_input >> bit) & 1;
+    const int run =
+        has_observed_[player_id] ? current_runs_[player_id][bit] : 1;
+
+    // Compare how many past runs lasted as long as the current one with how
+    // many lasted long enough to cover the predicted frame.
+    const auto run_count = CountRunsAtLeast(player_id, bit, state, run);
+    const auto lasting_run_count = CountRunsAtLeast(
+        player_id, bit, state, std::min(run + frames_ahead, kMaxRunLength));
+
+    const bool keeps_state =
+        run_count == 0 || lasting_run_count * 2 >= run_count;
+    const int predicted_state = keeps_state ? state : 1 - state;
+
+    prediction |= static_cast<input::Input>(predicted_state << bit);
+  }
+
+  return prediction;
+}
+
+void HoldDurationPrediction::Reset() noexcept {
+  PredictionStrategy::Reset();
+  for (auto& player_counts : run_counts_) {
+    for (auto& bit_counts : player_counts) {
+      for (auto& state_counts : bit_counts) {
+        state_counts.fill(0);
+      }
+    }
+  }
+  for (auto& player_runs : current_runs_) {
+    player_runs.fill(0);
+  }
+  last_inputs_.fill(0);
+  has_observed_.fill(false);
+}
+
+void HoldDurationPrediction::OnObserve(int player_id,
+                                       input::Input input) noexcept {
+  auto& runs = current_runs_[player_id];
+
+  for (int bit = 0; bit < kInputBitCount; bit++) {
+    const int state = (input >> bit) & 1;
+    const int last_state = (last_inputs_[player_id] >> bit) & 1;
+
+    if (!has_observed_[player_id]) {
+      runs[bit] = 1;
+    } else if (state == last_state) {
+      runs[bit] = std::min(runs[bit] + 1, kMaxRunLength);
+    } else {
+      run_counts_[player_id][bit][last_state][runs[bit]]++;
+      runs[bit] = 1;
+    }
+  }
+
+  last_inputs_[player_id] = input;
+  has_observed_[player_id] = true;
+}
+
+std::uint32_t HoldDurationPrediction::CountRunsAtLeast(
+    int player_id, int bit, int state, int length) const noexcept {
+  std::uint32_t count = 0;
+  for (int run = length; run <= kMaxRunLength; run++) {
+    count += run_counts_[player_id][bit][state][run];
+  }
+  return count;
+}
@@ -0,0 +1,137 @@
+#include "replay.h"
+
+#include <fstream>
+#include <iterator>
+
+#include "state_reader.h"
+#include "state_writer.h"
+
+bool Replay::AddFrame(const ConfirmedFrame& frame) {
+  if (frame.frame_nbr != GetFrameCount()) {
+    return false;
+  }
+
+  inputs.push_back(frame.inputs);
+  if (HasChecksum(frame.frame_nbr)) {
+    checksums.push_back(frame.checksum);
+  }
+  return true;
+}
+
+int Replay::Play(Game& game) const {
+  // Assigning a new game would leave the quad tree nodes with the allocator
+  // of the temporary game, restart it instead.
+  game.Restart();
+  game.SetBallType(ball_type);
+  game.SetPlayerCount(player_count);
+  game.StartGame();
+  game.SetResimulating(true);
+
+  for (int frame_nbr = 0; frame_nbr < GetFrameCount(); frame_nbr++) {
+    const auto& frame_inputs = inputs[frame_nbr];
+    for (int player_id = 0; player_id < player_count; player_id++) {
+      game.SetPlayerInput(player_id, frame_inputs[player_id]);
+    }
+    game.FixedUpdate();
+
+    if (HasChecksum(frame_nbr) && game.CheckSum() != GetChecksum(frame_nbr)) {
+      return frame_nbr;
+    }
+  }
+  return -1;
+}
+
+bool Replay::Save(const std::string& path) const {
+  StateWriter writer;
+  writer.WriteU32(kMagic);
+  writer.WriteU32(kVersion);
+
+  writer.WriteInt(player_count);
+  writer.WriteU8(static_cast<std::uint8_t>(ball_type));
+  writer.WriteInt(player_nbr);
+  writer.WriteU32(static_cast<std::uint32_t>(inputs.size()));
+
+  // The players hold the same buttons for many frames, write each run of
+  // identical frames once with its length.
+  std::size_t run_start = 0;
+  while (run_start < inputs.size()) {
+    std::size_t run_end = run_start + 1;
+    while (run_end < inputs.size() && inputs[run_end] == inputs[run_start]) {
+      run_end++;
+    }
+    writer.WriteU32(static_cast<std::uint32_t>(run_end - run_start));
+    for (int player_id = 0; player_id < player_count; player_id++) {
+      writer.WriteU8(inputs[run_start][player_id]);
+    }
+    run_start = run_end;
+  }
+
+  writer.WriteU32(static_cast<std::uint32_t>(checksums.size()));
+  for (const int checksum : checksums) {
+    writer.WriteInt(checksum);
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(writer.GetData()),
+             static_cast<std::streamsize>(writer.GetSize()));
+  return file.good();
+}
+
+bool Replay::Load(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  const std::vector<std::uint8_t> data(std::istreambuf_iterator<char>(file),
+                                       {});
+
+  StateReader reader(data);
+  if (reader.ReadU32() != kMagic || reader.ReadU32() != kVersion) {
+    return false;
+  }
+
+  player_count = reader.ReadInt();
+  ball_type = static_cast<BallType>(reader.ReadU8());
+  player_nbr = reader.ReadInt();
+  if (player_count < metrics::kMinPlayerNbr ||
+      player_count > metrics::kMaxPlayerNbr) {
+    return false;
+  }
+
+  // A match cannot be longer than the game duration, this also rejects the
+  // corrupted sizes before allocating.
+  const auto frame_count = reader.ReadU32();
+  if (frame_count > static_cast<std::uint32_t>(metrics::kGameFrameNbr)) {
+    return false;
+  }
+
+  inputs.clear();
+  inputs.reserve(frame_count);
+  while (inputs.size() < frame_count && !reader.HasFailed()) {
+    const auto run_length = reader.ReadU32();
+    // Loop over the whole array so the compiler sees the bound, the inputs
+    // of the missing players stay empty.
+    FrameInputs frame_inputs{};
+    for (std::size_t player_id = 0; player_id < frame_inputs.size();
+         player_id++) {
+      if (static_cast<int>(player_id) < player_count) {
+        frame_inputs[player_id] = reader.ReadU8();
+      }
+    }
+    if (run_length == 0 || run_length > frame_count - inputs.size()) {
+      return false;
+    }
+    inputs.insert(inputs.end(), run_length, frame_inputs);
+  }
+
+  const auto checksum_count = reader.ReadU32();
+  if (checksum_count != frame_count / kChecksumInterval) {
+    return false;
+  }
+  checksums.resize(checksum_count);
+  for (auto& checksum : checksums) {
+    checksum = reader.ReadInt();
+  }
+
+  return !reader.HasFailed();
+}
@@ -1,5 +1,7 @@
 #include "rollback.h"
 
+#include <algorithm>
+
 #ifdef TRACY_ENABLE
 #include <TracyC.h>
 
@@ -8,69 +10,93 @@
 
 void Rollback::SetPlayerInput(const input::FrameInput& local_input,
                               int player_id) {
-  inputs_[player_id][local_input.frame_nbr] = local_input.input;
-  last_inputs_[player_id] = local_input.input;
+  session_.SetInput(player_id, local_input.frame_nbr, local_input.input);
+  session_.SetLastInput(player_id, local_input.frame_nbr, local_input.input);
 }
 
 void Rollback::SetOtherPlayerInput(
     const std::vector<input::FrameInput>& new_remote_inputs, int player_id) {
+  const int last_input_frame = session_.GetLastInputFrame(player_id);
+  const int current_frame = session_.GetCurrentFrame();
+
   // Retrieve the last remote frame input
   auto last_new_remote_input = new_remote_inputs.back();
 
   // Calculate the difference between the last new remote frame and the last
   // remote input frame
-  const auto frame_diff =
-      last_new_remote_input.frame_nbr - last_remote_input_frame_;
+  const auto frame_diff = last_new_remote_input.frame_nbr - last_input_frame;
 
   // If no new inputs received, return
   if (frame_diff < 1) {
     return;
   }
 
-  // If the last remote input frame is greater than the current frame, adjust
-  // last_new_remote_input
-  if (last_new_remote_input.frame_nbr > current_frame_) {
-    const auto& current_frame_it =
-        std::find_if(new_remote_inputs.begin(), new_remote_inputs.end(),
-                     [this](const input::FrameInput& frame_input) {
-                       return frame_input.frame_nbr == current_frame_;
-                     });
-    last_new_remote_input = *current_frame_it;
-  }
-
   // Find the position of the first missing input
   auto missing_input_it = std::find_if(
       new_remote_inputs.begin(), new_remote_inputs.end(),
-      [this](const input::FrameInput& frame_input) {
-        return frame_input.frame_nbr == last_remote_input_frame_ + 1;
+      [last_input_frame](const input::FrameInput& frame_input) {
+        return frame_input.frame_nbr == last_input_frame + 1;
       });
 
+  // The inputs do not follow the ones we know, the missing ones will come
+  // with the frame confirmation.
+  if (missing_input_it == new_remote_inputs.end()) {
+    return;
+  }
+
+  // The inputs after the current frame are kept for when it reaches them, up
+  // to the end of the window.
+  const int last_window_frame =
+      session_.GetConfirmedFrame() + Session::kMaxWindow;
+  if (last_new_remote_input.frame_nbr > last_window_frame) {
+    if (last_input_frame >= last_window_frame) {
+      return;
+    }
+    const auto& last_window_it = std::find_if(
+        new_remote_inputs.begin(), new_remote_inputs.end(),
+        [last_window_frame](const input::FrameInput& frame_input) {
+          return frame_input.frame_nbr == last_window_frame;
+        });
+    last_new_remote_input = *last_window_it;
+  }
+
   // Check if rollback is necessary
-  bool must_rollback = last_remote_input_frame_ == -1;
+  bool must_rollback = last_input_frame == -1;
 
   // Iterate over the missing inputs and update the inputs array
-  for (short frame = last_remote_input_frame_ + 1;
+  for (int frame = last_input_frame + 1;
        frame <= last_new_remote_input.frame_nbr; frame++) {
     // Get the input for the current frame
     const auto input = missing_input_it->input;
 
-    // Check if rollback is necessary
-    if (last_remote_input_frame_ > -1 && input != last_inputs_[player_id]) {
-      must_rollback = true;
+    // The simulated frames used a predicted input, check if the prediction
+    // was right.
+    if (last_input_frame > -1 && frame <= session_.GetSimulatedFrame()) {
+      const bool is_hit = input == session_.GetInput(player_id, frame);
+      prediction_->RecordPrediction(is_hit);
+      telemetry_.RecordPrediction(is_hit);
+      if (!is_hit) {
+        must_rollback = true;
+      }
     }
 
+    prediction_->Observe(player_id, input);
+
     // Update the inputs array
-    inputs_[player_id][frame] = missing_input_it->input;
+    session_.SetInput(player_id, frame, missing_input_it->input);
 
     // Move to the next missing input
     ++missing_input_it;
   }
 
-  // Predict inputs for frames up to the current frame with the last remote
+  // Predict inputs for frames up to the current frame from the last remote
   // input.
-  for (short frame = last_new_remote_input.frame_nbr; frame <= current_frame_;
+  for (int frame = last_new_remote_input.frame_nbr + 1; frame <= current_frame;
        frame++) {
-    inputs_[player_id][frame] = last_new_remote_input.input;
+    const auto predicted_input =
+        prediction_->Predict(player_id, last_new_remote_input.input,
+                             frame - last_new_remote_input.frame_nbr);
+    session_.SetInput(player_id, frame, predicted_input);
   }
 
   if (must_rollback) {
@@ -78,70 +104,359 @@ void Rollback::SetOtherPlayerInput(
   }
 
   // Update last inputs and last remote input frame.
-  last_inputs_[player_id] = last_new_remote_input.input;
-  last_remote_input_frame_ = last_new_remote_input.frame_nbr;
+  session_.SetLastInput(player_id, last_new_remote_input.frame_nbr,
+                        last_new_remote_input.input);
+}
+
+void Rollback::IncreaseCurrentFrame() noexcept {
+  // Predict the inputs of the new frame, they are overwritten if the real
+  // inputs are received before the frame is simulated.
+  session_.IncreaseCurrentFrame(
+      [this](int player_id, input::Input last_input, int frame_count) {
+        return prediction_->Predict(player_id, last_input, frame_count);
+      });
+}
+
+void Rollback::DoRollback() noexcept {
+#ifdef TRACY_ENABLE
+  ZoneScoped;
+#endif
+  const auto start_time = RollbackTelemetry::Clock::now();
+  const int simulated_frame = session_.GetSimulatedFrame();
+
+  int first_frame = session_.GetConfirmedFrame() + 1;
+  // Every body is simulated again unless only a part of the world changed.
+  BodyMask changed_bodies = ~BodyMask{0};
+
+  const auto* branch = FindMatchingBranch();
+  if (branch != nullptr) {
+    // A worker already simulated the frames of the branch with the right
+    // inputs, start from its end instead of the confirmed state.
+    for (int frame = branch->base_frame + 1; frame <= branch->end_frame;
+         frame++) {
+      session_.GetSnapshot(frame).Copy(branch->snapshots[frame]);
+    }
+    first_frame = branch->end_frame + 1;
+  } else {
+    // The frames before the first changed input are already right.
+    changed_bodies = 0;
+    first_frame = FindFirstChangedFrame(changed_bodies);
+  }
+
+  // The frames of a catch-up in progress are not up to date either.
+  if (IsCatchingUp()) {
+    first_frame = std::min(first_frame, catch_up_frame_);
+    changed_bodies |= catch_up_bodies_;
+  }
+  // Nothing changed in the simulated frames, a branch still has to be
+  // loaded even if it ends at the last simulated frame.
+  if (branch == nullptr && first_frame > simulated_frame) {
+    return;
+  }
+
+  const int depth = simulated_frame - first_frame + 1;
+  prediction_->RecordRollback(depth);
+
+  catch_up_frame_ = first_frame;
+  catch_up_bodies_ = changed_bodies;
+  CatchUp(GetResimulationBudgetLeft());
+
+  telemetry_.RecordRollback(depth,
+                            RollbackTelemetry::Clock::now() - start_time);
 }
 
-void Rollback::DoRollback() const noexcept {
+void Rollback::CatchUp(int frame_count) noexcept {
 #ifdef TRACY_ENABLE
   ZoneScoped;
 #endif
-  // Copy the confirmed game state to the current state
-  current_->Copy(confirmed_);
-
-  // Loop through the frames from the first frame after the confirmed frame to
-  // the current frame
-  for (short frame = static_cast<short>(confirmed_frame_ + 1);
-       frame < current_frame_; frame++) {
-    // Loop through each player
-    for (int player_id = 0; player_id < 2; player_id++) {
-      // Retrieve the input for the player at the current frame
-      const auto input = inputs_[player_id][frame];
-      // Apply the player's input to the game state based on their player ID
-      if (current_->player_nbr == player_id) {
-        current_->SetPlayerInput(input);
-      } else {
-        current_->SetOtherPlayerInput(input);
+  const int first_frame = catch_up_frame_;
+  const int last_frame = session_.GetSimulatedFrame();
+  const Game& base = first_frame - 1 > session_.GetConfirmedFrame()
+                         ? session_.GetSnapshot(first_frame - 1)
+                         : session_.GetConfirmedGame();
+  const auto island = GetRollbackIsland(first_frame, catch_up_bodies_);
+
+  update_resimulated_frames_ +=
+      std::min(frame_count, last_frame - first_frame + 1);
+
+  if (first_frame + frame_count > last_frame) {
+    // Load the base state and simulate again the frames from the first frame
+    // that is not known to the last simulated frame.
+    current_->SetResimulating(true);
+    ResimulateFrames(*current_, base, first_frame, last_frame, island);
+    current_->SetResimulating(false);
+
+    catch_up_frame_ = -1;
+    catch_up_bodies_ = 0;
+    return;
+  }
+
+  if (frame_count > 0) {
+    ResimulateFrames(catch_up_game_, base, first_frame,
+                     first_frame + frame_count - 1, island);
+  }
+  catch_up_frame_ = first_frame + frame_count;
+  catch_up_bodies_ = island;
+}
+
+int Rollback::GetResimulationBudgetLeft() const noexcept {
+  if (resimulation_budget_ == 0) {
+    return metrics::kMaxRollbackFrames;
+  }
+  return std::max(resimulation_budget_ - update_resimulated_frames_, 0);
+}
+
+int Rollback::FindFirstChangedFrame(BodyMask& changed_bodies) const noexcept {
+  const int simulated_frame = session_.GetSimulatedFrame();
+  int first_frame = simulated_frame + 1;
+  for (int frame = session_.GetConfirmedFrame() + 1; frame <= simulated_frame;
+       frame++) {
+    const auto& snapshot = session_.GetSnapshot(frame);
+    for (int player_id = 0; player_id < session_.GetPlayerCount();
+         player_id++) {
+      if (session_.GetInput(player_id, frame) !=
+          snapshot.GetPlayerInput(player_id)) {
+        first_frame = std::min(first_frame, frame);
+        changed_bodies |= snapshot.GetPlayerBodyMask(player_id);
       }
     }
+  }
+  return first_frame;
+}
+
+BodyMask Rollback::GetRollbackIsland(int first_frame,
+                                     BodyMask changed_bodies) const noexcept {
+  // A body can reach the island in a frame and touch another body in an
+  // earlier frame, repeat until no body is added.
+  BodyMask island = changed_bodies;
+  BodyMask previous_island = 0;
+  while (island != previous_island) {
+    previous_island = island;
+    for (int frame = first_frame; frame <= session_.GetSimulatedFrame();
+         frame++) {
+      island = session_.GetSnapshot(frame).AddInteractingBodies(island);
+    }
+  }
+  return island;
+}
+
+void Rollback::ResimulateFrames(Game& game, const Game& base,
+                                int first_frame, int last_frame,
+                                BodyMask island) noexcept {
+#ifdef TRACY_ENABLE
+  ZoneScoped;
+#endif
+  game.Copy(base);
+
+  const auto dynamic_bodies = game.GetDynamicBodyMask();
+  if ((island & dynamic_bodies) == dynamic_bodies) {
+    session_.ResimulateFrames(game, first_frame, last_frame);
+    return;
+  }
 
-    // Perform a fixed update on the current game state
-    current_->FixedUpdate();
+  for (int frame = first_frame; frame <= last_frame; frame++) {
+    for (int player_id = 0; player_id < session_.GetPlayerCount();
+         player_id++) {
+      game.SetPlayerInput(player_id, session_.GetInput(player_id, frame));
+    }
+    // The snapshot still holds the rest of the world, simulated with the
+    // same inputs.
+    auto& snapshot = session_.GetSnapshot(frame);
+    if (!game.FixedUpdateIsland(island, snapshot)) {
+      // The state before this frame is right, the rest of the world is
+      // simulated from there.
+      game.Copy(frame == first_frame ? base : session_.GetSnapshot(frame - 1));
+      session_.ResimulateFrames(game, frame, last_frame);
+      return;
+    }
+    game.CopyOutsideIsland(snapshot, island);
+    snapshot.Copy(game);
   }
 }
 
-int Rollback::ConfirmFrame() noexcept {
+void Rollback::SimulateCurrentFrame() noexcept {
 #ifdef TRACY_ENABLE
   ZoneScoped;
 #endif
-  // Loop through each player 
-  for (int player_id = 0; player_id < 2; player_id++) {
-    // Retrieve the input for the player at the frame to be confirmed
-    const auto input = inputs_[player_id][frame_to_confirm_];
-    // Apply the player's input to the confirmed game state based on their
-    // player ID
-    if (confirmed_.player_nbr == player_id) {
-      confirmed_.SetPlayerInput(input);
-    } else {
-      confirmed_.SetOtherPlayerInput(input);
+  if (IsCatchingUp()) {
+    CatchUp(GetResimulationBudgetLeft());
+  }
+
+  session_.SimulateCurrentFrame();
+  telemetry_.EndFrame(session_.GetCurrentFrame(),
+                      session_.GetConfirmedFrame());
+
+  Speculate();
+}
+
+void Rollback::Speculate() noexcept {
+  // The snapshots of a catch-up are not a valid base until it is done.
+  if (speculation_ == nullptr || speculation_->IsRunning() || IsCatchingUp()) {
+    return;
+  }
+
+  const int player_count = session_.GetPlayerCount();
+  const int simulated_frame = session_.GetSimulatedFrame();
+
+  // The remote player with the oldest known input has the longest prediction,
+  // it is the most likely to cause a deep rollback.
+  int player_id = 0;
+  for (int other_id = 1; other_id < player_count; other_id++) {
+    if (session_.GetLastInputFrame(other_id) <
+        session_.GetLastInputFrame(player_id)) {
+      player_id = other_id;
+    }
+  }
+
+  const int first_predicted_frame = session_.GetLastInputFrame(player_id) + 1;
+  if (first_predicted_frame > simulated_frame) {
+    return;
+  }
+
+  // The inputs of every player are known up to the confirmation frontier, so
+  // the state at this frame will not be rolled back.
+  const int base_frame = session_.GetConfirmationFrontier();
+  const Game& base_game = base_frame == session_.GetConfirmedFrame()
+                              ? session_.GetConfirmedGame()
+                              : session_.GetSnapshot(base_frame);
+
+  // Speculate that the player changed one of the bits it changes the most
+  // often and kept it changed.
+  const auto bits = prediction_->GetBitsByChangeCount(player_id);
+  const auto last_input = session_.GetLastInput(player_id);
+
+  for (int branch_index = 0; branch_index < speculation_->GetBranchCount();
+       branch_index++) {
+    auto& branch = speculation_->GetBranch(branch_index);
+    const auto alternative_input =
+        static_cast<input::Input>(last_input ^ (1 << bits[branch_index]));
+
+    branch.game.Copy(base_game);
+    branch.base_frame = base_frame;
+    branch.end_frame = simulated_frame;
+
+    for (int frame = base_frame + 1; frame <= simulated_frame; frame++) {
+      for (int other_id = 0; other_id < player_count; other_id++) {
+        branch.inputs[frame][other_id] = session_.GetInput(other_id, frame);
+      }
+      if (frame >= first_predicted_frame) {
+        branch.inputs[frame][player_id] = alternative_input;
+      }
+    }
+  }
+
+  speculation_->Run();
+}
+
+const SpeculativeBranch* Rollback::FindMatchingBranch() const noexcept {
+  // Do not wait for the workers, a branch that is not finished is not worth
+  // more than a rollback.
+  if (speculation_ == nullptr || speculation_->IsRunning()) {
+    return nullptr;
+  }
+
+  for (int branch_index = 0; branch_index < speculation_->GetBranchCount();
+       branch_index++) {
+    const auto& branch = speculation_->GetBranch(branch_index);
+
+    // The inputs of the frames before the confirmed frame may have been
+    // overwritten, and the frames after the simulated one are not simulated.
+    if (branch.IsEmpty() || branch.base_frame < session_.GetConfirmedFrame() ||
+        branch.end_frame > session_.GetSimulatedFrame()) {
+      continue;
+    }
+
+    bool is_matching = true;
+    for (int frame = branch.base_frame + 1;
+         frame <= branch.end_frame && is_matching; frame++) {
+      for (int player_id = 0; player_id < session_.GetPlayerCount();
+           player_id++) {
+        if (branch.inputs[frame][player_id] !=
+            session_.GetInput(player_id, frame)) {
+          is_matching = false;
+          break;
+        }
+      }
     }
+
+    if (is_matching) {
+      return &branch;
+    }
+  }
+
+  return nullptr;
+}
+
+void Rollback::ConfirmFrame() noexcept {
+#ifdef TRACY_ENABLE
+  ZoneScoped;
+#endif
+  const auto start_time = RollbackTelemetry::Clock::now();
+  const int frame_to_confirm = GetFrameToConfirm();
+  ConfirmedFrame confirmed_frame{};
+  confirmed_frame.frame_nbr = frame_to_confirm;
+  for (int player_id = 0; player_id < session_.GetPlayerCount(); player_id++) {
+    confirmed_frame.inputs[player_id] =
+        session_.GetInput(player_id, frame_to_confirm);
+  }
+
+  // The snapshot of the frame must be up to date before it is promoted, a
+  // confirmed frame is never left to a later frame.
+  if (IsCatchingUp() && frame_to_confirm >= catch_up_frame_) {
+    CatchUp(frame_to_confirm - catch_up_frame_ + 1);
+  }
+
+  // Promotes the snapshot of the frame if it was already simulated with the
+  // right inputs, or simulates the frame on the confirmed game.
+  session_.ConfirmFrame();
+
+  // The checksum is computed by the worker, from its own confirmed timeline.
+  confirmation_worker_.PushFrame(confirmed_frame);
+
+  telemetry_.RecordConfirmation(RollbackTelemetry::Clock::now() - start_time);
+}
+
+void Rollback::RestoreConfirmedState(int frame_nbr, const Game& state) {
+  session_.Restore(state, frame_nbr);
+  // The inputs of the frame are in the state, the next ones are predicted
+  // from them until they are received again.
+  for (int player_id = 0; player_id < session_.GetPlayerCount(); player_id++) {
+    const auto input = state.GetPlayerInput(player_id);
+    session_.SetInput(player_id, frame_nbr, input);
+    session_.SetLastInput(player_id, frame_nbr, input);
   }
 
-  // Perform a fixed update on the confirmed game state
-  confirmed_.FixedUpdate();
+  catch_up_frame_ = -1;
+  catch_up_bodies_ = 0;
+  update_resimulated_frames_ = 0;
+  if (speculation_ != nullptr) {
+    speculation_->Reset();
+  }
+  confirmation_worker_.Start(session_.GetConfirmedGame());
+}
 
-  // Calculate the checksum of the confirmed game state
-  const auto checksum = confirmed_.CheckSum();
+void Rollback::ReplayConfirmedFrame(
+    const ConfirmedFrame& confirmed_frame) noexcept {
+  const int frame_nbr = confirmed_frame.frame_nbr;
+  session_.IncreaseCurrentFrame();
+  for (int player_id = 0; player_id < session_.GetPlayerCount(); player_id++) {
+    const auto input = confirmed_frame.inputs[player_id];
+    session_.SetInput(player_id, frame_nbr, input);
+    // The local inputs may be known further already.
+    if (session_.GetLastInputFrame(player_id) < frame_nbr) {
+      session_.SetLastInput(player_id, frame_nbr, input);
+    }
+  }
 
-  // Increment the confirmed frame counter and the frame to confirm
-  confirmed_frame_++;
-  frame_to_confirm_++;
+  // The frames were already shown, only their state is needed.
+  current_->SetResimulating(true);
+  session_.SimulateCurrentFrame();
+  current_->SetResimulating(false);
 
-  // Return the calculated checksum
-  return checksum;
+  ConfirmFrame();
 }
 
 const input::Input& Rollback::GetLastPlayerInput(
     const int player_id) const noexcept {
-  return last_inputs_[player_id];
+  return session_.GetLastInput(player_id);
 }
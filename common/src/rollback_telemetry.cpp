@@ -0,0 +1,125 @@
+#include "rollback_telemetry.h"
+
+#include <algorithm>
+
+#ifdef TRACY_ENABLE
+#include <Tracy.hpp>
+#endif
+
+namespace {
+
+float ToMilliseconds(RollbackTelemetry::Clock::duration duration) noexcept {
+  return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+}  // namespace
+
+void RollbackTelemetry::RecordRollback(int depth,
+                                       Clock::duration duration) noexcept {
+  depth = std::clamp(depth, 0, metrics::kMaxRollbackFrames);
+  depth_histogram_[depth]++;
+  rollback_count_++;
+
+  window_.rollback_count++;
+  window_.depth_sum += depth;
+  window_.rollback_time += duration;
+
+#ifdef TRACY_ENABLE
+  TracyPlot("Rollback depth", static_cast<std::int64_t>(depth));
+#endif
+}
+
+void RollbackTelemetry::RecordConfirmation(Clock::duration duration) noexcept {
+  window_.confirmation_time += duration;
+}
+
+void RollbackTelemetry::RecordPrediction(bool is_hit) noexcept {
+  if (is_hit) {
+    window_.hit_count++;
+  } else {
+    window_.miss_count++;
+  }
+}
+
+void RollbackTelemetry::EndFrame(int current_frame,
+                                 int confirmed_frame) noexcept {
+  const int lag = current_frame - confirmed_frame;
+  window_.lag_sum += lag;
+  window_.max_lag = std::max(window_.max_lag, lag);
+  window_.frame_count++;
+
+  if (window_.frame_count >= kWindowFrames) {
+    PublishWindow();
+  }
+}
+
+void RollbackTelemetry::PublishWindow() noexcept {
+  const float seconds =
+      static_cast<float>(window_.frame_count) * metrics::kFixedDeltaTime;
+  const auto prediction_count = window_.hit_count + window_.miss_count;
+
+  last_stats_.rollbacks_per_second =
+      static_cast<float>(window_.rollback_count) / seconds;
+  last_stats_.average_rollback_depth =
+      window_.rollback_count == 0
+          ? 0.f
+          : static_cast<float>(window_.depth_sum) /
+                static_cast<float>(window_.rollback_count);
+  last_stats_.rollback_time_ms = ToMilliseconds(window_.rollback_time);
+  last_stats_.confirmation_time_ms = ToMilliseconds(window_.confirmation_time);
+  last_stats_.prediction_hit_rate =
+      prediction_count == 0 ? 1.f
+                            : static_cast<float>(window_.hit_count) /
+                                  static_cast<float>(prediction_count);
+  last_stats_.average_confirmed_lag =
+      static_cast<float>(window_.lag_sum) /
+      static_cast<float>(window_.frame_count);
+  last_stats_.max_confirmed_lag = window_.max_lag;
+
+#ifdef TRACY_ENABLE
+  TracyPlot("Rollbacks/s", last_stats_.rollbacks_per_second);
+  TracyPlot("Rollback time (ms/s)", last_stats_.rollback_time_ms);
+  TracyPlot("Confirmation time (ms/s)", last_stats_.confirmation_time_ms);
+  TracyPlot("Prediction hit rate", last_stats_.prediction_hit_rate);
+  TracyPlot("Confirmed lag", last_stats_.average_confirmed_lag);
+#endif
+
+  if (csv_.is_open()) {
+    csv_ << window_count_ << ',' << last_stats_.rollbacks_per_second << ','
+         << last_stats_.average_rollback_depth << ','
+         << last_stats_.rollback_time_ms << ','
+         << last_stats_.confirmation_time_ms << ','
+         << last_stats_.prediction_hit_rate << ','
+         << last_stats_.average_confirmed_lag << ','
+         << last_stats_.max_confirmed_lag << '\n';
+  }
+
+  window_count_++;
+  window_ = Window{};
+}
+
+bool RollbackTelemetry::OpenCsv(const std::string& path) {
+  CloseCsv();
+  csv_.open(path);
+  if (!csv_.is_open()) {
+    return false;
+  }
+  csv_ << "second,rollbacks_per_second,average_rollback_depth,"
+          "rollback_time_ms,confirmation_time_ms,prediction_hit_rate,"
+          "average_confirmed_lag,max_confirmed_lag\n";
+  return true;
+}
+
+void RollbackTelemetry::CloseCsv() noexcept {
+  if (csv_.is_open()) {
+    csv_.close();
+  }
+}
+
+void RollbackTelemetry::Reset() noexcept {
+  window_ = Window{};
+  last_stats_ = RollbackStats{};
+  depth_histogram_.fill(0);
+  rollback_count_ = 0;
+  window_count_ = 0;
+}
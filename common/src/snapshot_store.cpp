@@ -0,0 +1,171 @@
+#include "snapshot_store.h"
+
+#include <algorithm>
+
+#include "state_reader.h"
+#include "tracy_lz4.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+float GetAverageMicroseconds(Clock::duration duration, int count) noexcept {
+  if (count == 0) {
+    return 0.f;
+  }
+  return std::chrono::duration<float, std::micro>(duration).count() /
+         static_cast<float>(count);
+}
+
+/**
+ * @brief XORs the common part of two states in the first one, the rest of
+ * the first state is kept as is.
+ */
+void XorStates(std::vector<std::uint8_t>& state,
+               const std::vector<std::uint8_t>& keyframe_state) noexcept {
+  const auto size = std::min(state.size(), keyframe_state.size());
+  for (std::size_t index = 0; index < size; index++) {
+    state[index] ^= keyframe_state[index];
+  }
+}
+
+}  // namespace
+
+float SnapshotStoreStats::GetAverageEncodeMicroseconds() const noexcept {
+  return GetAverageMicroseconds(encode_time, save_count);
+}
+
+float SnapshotStoreStats::GetAverageDecodeMicroseconds() const noexcept {
+  return GetAverageMicroseconds(decode_time, load_count);
+}
+
+SnapshotStore::SnapshotStore(int keyframe_interval) noexcept
+    : keyframe_interval_(std::clamp(keyframe_interval, 1, kCapacity)),
+      entries_(kCapacity + keyframe_interval_ - 1) {}
+
+void SnapshotStore::Save(int frame_nbr, const Game& game) {
+  const auto start_time = Clock::now();
+
+  writer_.Clear();
+  game.Serialize(writer_);
+
+  auto& entry = GetEntry(frame_nbr);
+  entry.frame_nbr = frame_nbr;
+  entry.version = ++last_version_;
+  entry.raw_size = writer_.GetSize();
+
+  const int keyframe_nbr = frame_nbr - frame_nbr % keyframe_interval_;
+  if (keyframe_nbr == frame_nbr) {
+    keyframe_state_.assign(writer_.GetData(),
+                           writer_.GetData() + writer_.GetSize());
+    keyframe_nbr_ = frame_nbr;
+    keyframe_version_ = entry.version;
+
+    entry.keyframe_nbr = -1;
+    Compress(entry, writer_.GetData(), writer_.GetSize());
+  } else {
+    const auto& keyframe = GetEntry(keyframe_nbr);
+    if (keyframe.frame_nbr == keyframe_nbr &&
+        LoadKeyframe(keyframe_nbr, keyframe.version)) {
+      delta_.assign(writer_.GetData(), writer_.GetData() + writer_.GetSize());
+      XorStates(delta_, keyframe_state_);
+
+      entry.keyframe_nbr = keyframe_nbr;
+      entry.keyframe_version = keyframe.version;
+      Compress(entry, delta_.data(), delta_.size());
+    } else {
+      // The keyframe was never saved, the frame is kept whole.
+      entry.keyframe_nbr = -1;
+      Compress(entry, writer_.GetData(), writer_.GetSize());
+    }
+  }
+
+  stats_.save_count++;
+  stats_.raw_bytes += entry.raw_size;
+  stats_.compressed_bytes += entry.data.size();
+  stats_.encode_time += Clock::now() - start_time;
+}
+
+bool SnapshotStore::Load(int frame_nbr, Game& game) {
+  const auto start_time = Clock::now();
+
+  const auto& entry = GetEntry(frame_nbr);
+  if (entry.frame_nbr != frame_nbr || !Decompress(entry, delta_)) {
+    return false;
+  }
+
+  if (entry.keyframe_nbr != -1) {
+    const auto& keyframe = GetEntry(entry.keyframe_nbr);
+    if (keyframe.frame_nbr != entry.keyframe_nbr ||
+        keyframe.version != entry.keyframe_version ||
+        !LoadKeyframe(entry.keyframe_nbr, entry.keyframe_version)) {
+      return false;
+    }
+    XorStates(delta_, keyframe_state_);
+  }
+
+  StateReader reader(delta_);
+  if (!game.Deserialize(reader)) {
+    return false;
+  }
+
+  stats_.load_count++;
+  stats_.decode_time += Clock::now() - start_time;
+  return true;
+}
+
+std::size_t SnapshotStore::GetMemorySize() const noexcept {
+  std::size_t size = keyframe_state_.capacity() + compressed_.capacity();
+  for (const auto& entry : entries_) {
+    size += entry.data.capacity();
+  }
+  return size;
+}
+
+void SnapshotStore::Reset() noexcept {
+  for (auto& entry : entries_) {
+    entry.frame_nbr = -1;
+    entry.keyframe_nbr = -1;
+    entry.raw_size = 0;
+    entry.data.clear();
+  }
+  keyframe_nbr_ = -1;
+  stats_ = {};
+}
+
+bool SnapshotStore::LoadKeyframe(int keyframe_nbr,
+                                 std::uint32_t keyframe_version) {
+  if (keyframe_nbr_ == keyframe_nbr && keyframe_version_ == keyframe_version) {
+    return true;
+  }
+  const auto& keyframe = GetEntry(keyframe_nbr);
+  if (keyframe.keyframe_nbr != -1 || !Decompress(keyframe, keyframe_state_)) {
+    keyframe_nbr_ = -1;
+    return false;
+  }
+  keyframe_nbr_ = keyframe_nbr;
+  keyframe_version_ = keyframe_version;
+  return true;
+}
+
+void SnapshotStore::Compress(Entry& entry, const std::uint8_t* data,
+                             std::size_t size) {
+  // Compressed in a buffer large enough for any data, then copied so the
+  // entry only keeps the memory of its compressed size.
+  const int source_size = static_cast<int>(size);
+  compressed_.resize(tracy::LZ4_compressBound(source_size));
+  const int compressed_size = tracy::LZ4_compress_default(
+      reinterpret_cast<const char*>(data), compressed_.data(), source_size,
+      static_cast<int>(compressed_.size()));
+  entry.data.assign(compressed_.begin(),
+                    compressed_.begin() + std::max(compressed_size, 0));
+}
+
+bool SnapshotStore::Decompress(const Entry& entry,
+                               std::vector<std::uint8_t>& state) {
+  state.resize(entry.raw_size);
+  const int size = tracy::LZ4_decompress_safe(
+      entry.data.data(), reinterpret_cast<char*>(state.data()),
+      static_cast<int>(entry.data.size()), static_cast<int>(state.size()));
+  return size == static_cast<int>(entry.raw_size);
+}
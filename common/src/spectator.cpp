@@ -0,0 +1,79 @@
+#include "spectator.h"
+
+#include <algorithm>
+#include <iostream>
+
+void Spectator::Start(Game* game) noexcept {
+  Reset();
+  game_ = game;
+}
+
+bool Spectator::AddConfirmedFrame(const ConfirmedFrame& confirmed_frame) {
+  // The confirmations are reliable so they arrive in order, but a frame may
+  // be received twice when it was also cached by the room.
+  if (confirmed_frame.frame_nbr != last_confirmed_frame_ + 1) {
+    return false;
+  }
+  frames_.push_back(confirmed_frame);
+  last_confirmed_frame_ = confirmed_frame.frame_nbr;
+  return true;
+}
+
+void Spectator::Update() noexcept {
+  if (game_ == nullptr) {
+    return;
+  }
+
+  const int buffered_frames = static_cast<int>(frames_.size());
+  if (buffered_frames == 0) {
+    stall_frames_++;
+    return;
+  }
+  stall_frames_ = 0;
+
+  if (!is_playing_) {
+    if (buffered_frames < kDelayFrames) {
+      return;
+    }
+    is_playing_ = true;
+  }
+
+  // Play one frame per step, and a few more while the spectator is further
+  // behind than the delay.
+  const int frame_count =
+      std::clamp(buffered_frames - kDelayFrames + 1, 1, kMaxCatchUpFrames);
+  for (int i = 0; i < frame_count; i++) {
+    SimulateNextFrame();
+  }
+}
+
+void Spectator::SimulateNextFrame() noexcept {
+  const auto& confirmed_frame = frames_.front();
+  for (int player_id = 0; player_id < game_->GetPlayerCount(); player_id++) {
+    game_->SetPlayerInput(player_id, confirmed_frame.inputs[player_id]);
+  }
+  game_->FixedUpdate();
+  simulated_frame_ = confirmed_frame.frame_nbr;
+
+  if (simulated_frame_ % kChecksumInterval == kChecksumInterval - 1 &&
+      game_->CheckSum() != confirmed_frame.checksum) {
+    std::cerr << "Not same checksum as the master client for frame: "
+              << simulated_frame_ << '\n';
+  }
+
+  frames_.pop_front();
+}
+
+bool Spectator::IsFinished() const noexcept {
+  return simulated_frame_ >= metrics::kGameFrameNbr - 1 ||
+         stall_frames_ >= kMaxStallFrames;
+}
+
+void Spectator::Reset() noexcept {
+  game_ = nullptr;
+  frames_.clear();
+  last_confirmed_frame_ = -1;
+  simulated_frame_ = -1;
+  is_playing_ = false;
+  stall_frames_ = 0;
+}
@@ -0,0 +1,97 @@
+#include "speculation.h"
+
+#ifdef TRACY_ENABLE
+#include <Tracy.hpp>
+#endif
+
+Speculation::Speculation(int branch_count) : branches_(branch_count) {
+  workers_.reserve(branch_count);
+  for (int branch_index = 0; branch_index < branch_count; branch_index++) {
+    workers_.emplace_back(&Speculation::WorkerLoop, this, branch_index);
+  }
+}
+
+Speculation::~Speculation() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  run_condition_.notify_all();
+
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void Speculation::Setup(int player_count, BallType ball_type) noexcept {
+  Reset();
+
+  player_count_ = player_count;
+  for (auto& branch : branches_) {
+    branch.game.SetBallType(ball_type);
+    branch.game.SetPlayerCount(player_count);
+    branch.game.StartGame();
+    // Nothing but the final state of a branch is observed.
+    branch.game.SetResimulating(true);
+  }
+}
+
+void Speculation::Run() noexcept {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_count_.store(GetBranchCount(), std::memory_order_relaxed);
+    run_count_++;
+  }
+  run_condition_.notify_all();
+}
+
+void Speculation::Reset() noexcept {
+  while (IsRunning()) {
+    std::this_thread::yield();
+  }
+
+  for (auto& branch : branches_) {
+    branch.base_frame = -1;
+    branch.end_frame = -1;
+  }
+}
+
+void Speculation::WorkerLoop(int branch_index) noexcept {
+  std::uint32_t last_run_count = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      run_condition_.wait(lock, [this, last_run_count] {
+        return is_stopping_ || run_count_ != last_run_count;
+      });
+
+      if (is_stopping_) {
+        return;
+      }
+      last_run_count = run_count_;
+    }
+
+    auto& branch = branches_[branch_index];
+    if (!branch.IsEmpty()) {
+      Simulate(branch);
+    }
+
+    running_count_.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+void Speculation::Simulate(SpeculativeBranch& branch) const noexcept {
+#ifdef TRACY_ENABLE
+  ZoneScoped;
+#endif
+  for (int frame = branch.base_frame + 1; frame <= branch.end_frame; frame++) {
+    for (int player_id = 0; player_id < player_count_; player_id++) {
+      branch.game.SetPlayerInput(player_id, branch.inputs[frame][player_id]);
+    }
+
+    branch.game.FixedUpdate();
+
+    branch.snapshots[frame].Copy(branch.game);
+  }
+}
@@ -0,0 +1,156 @@
+#include "state_transfer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "checksum.h"
+#include "state_reader.h"
+#include "tracy_lz4.hpp"
+
+void StateTransferSender::Start(int transfer_id, int frame_nbr,
+                                const Game& game) {
+  writer_.Clear();
+  game.Serialize(writer_);
+
+  transfer_id_ = transfer_id;
+  frame_nbr_ = frame_nbr;
+  raw_size_ = static_cast<int>(writer_.GetSize());
+  checksum_ = checksum::Crc32c(writer_.GetData(), writer_.GetSize());
+
+  compressed_.resize(tracy::LZ4_compressBound(raw_size_));
+  const int compressed_size = tracy::LZ4_compress_default(
+      reinterpret_cast<const char*>(writer_.GetData()), compressed_.data(),
+      raw_size_, static_cast<int>(compressed_.size()));
+  compressed_.resize(std::max(compressed_size, 0));
+
+  // An empty state still needs one chunk to tell its size.
+  const int chunk_count = std::max(
+      (static_cast<int>(compressed_.size()) + kChunkSize - 1) / kChunkSize, 1);
+  chunk_states_.assign(chunk_count, ChunkState{});
+  is_active_ = compressed_size > 0;
+  has_failed_ = !is_active_;
+}
+
+void StateTransferSender::GetChunksToSend(Clock::time_point now,
+                                          std::vector<StateChunk>& chunks) {
+  if (!is_active_) {
+    return;
+  }
+
+  int chunk_count = 0;
+  for (int chunk_index = 0;
+       chunk_index < GetChunkCount() && chunk_count < kMaxChunksPerSend;
+       chunk_index++) {
+    auto& chunk_state = chunk_states_[chunk_index];
+    if (chunk_state.is_acked || (chunk_state.send_count > 0 &&
+                                 now - chunk_state.last_send_time <
+                                     kResendDelay)) {
+      continue;
+    }
+    if (chunk_state.send_count >= kMaxSendCount) {
+      // The receiver is gone or the channel is too lossy, it will ask again.
+      is_active_ = false;
+      has_failed_ = true;
+      return;
+    }
+
+    StateChunk chunk;
+    chunk.transfer_id = transfer_id_;
+    chunk.frame_nbr = frame_nbr_;
+    chunk.chunk_index = chunk_index;
+    chunk.chunk_count = GetChunkCount();
+    chunk.raw_size = raw_size_;
+    chunk.checksum = checksum_;
+
+    const int begin = chunk_index * kChunkSize;
+    const int end =
+        std::min(begin + kChunkSize, static_cast<int>(compressed_.size()));
+    chunk.data.assign(compressed_.begin() + begin, compressed_.begin() + end);
+    chunks.push_back(std::move(chunk));
+
+    chunk_state.send_count++;
+    chunk_state.last_send_time = now;
+    chunk_count++;
+  }
+}
+
+void StateTransferSender::OnAck(
+    int transfer_id, const std::vector<int>& chunk_indices) noexcept {
+  if (!is_active_ || transfer_id != transfer_id_) {
+    return;
+  }
+  for (const int chunk_index : chunk_indices) {
+    if (chunk_index >= 0 && chunk_index < GetChunkCount()) {
+      chunk_states_[chunk_index].is_acked = true;
+    }
+  }
+  is_active_ = std::any_of(
+      chunk_states_.begin(), chunk_states_.end(),
+      [](const ChunkState& chunk_state) { return !chunk_state.is_acked; });
+}
+
+bool StateTransferReceiver::AddChunk(const StateChunk& chunk) {
+  if (chunk.transfer_id < transfer_id_ || chunk.chunk_count <= 0 ||
+      chunk.chunk_index < 0 || chunk.chunk_index >= chunk.chunk_count ||
+      chunk.raw_size <= 0) {
+    return false;
+  }
+
+  if (chunk.transfer_id > transfer_id_) {
+    transfer_id_ = chunk.transfer_id;
+    frame_nbr_ = chunk.frame_nbr;
+    chunk_count_ = chunk.chunk_count;
+    raw_size_ = chunk.raw_size;
+    checksum_ = chunk.checksum;
+    chunks_.assign(chunk_count_, {});
+    received_chunks_.clear();
+  } else if (chunk.frame_nbr != frame_nbr_ ||
+             chunk.chunk_count != chunk_count_ ||
+             chunk.raw_size != raw_size_ || chunk.checksum != checksum_) {
+    return false;
+  }
+
+  if (std::find(received_chunks_.begin(), received_chunks_.end(),
+                chunk.chunk_index) != received_chunks_.end()) {
+    // Sent again because the acknowledgment was lost.
+    return true;
+  }
+  chunks_[chunk.chunk_index] = chunk.data;
+  received_chunks_.push_back(chunk.chunk_index);
+  return true;
+}
+
+bool StateTransferReceiver::Load(Game& game) {
+  if (!IsComplete()) {
+    return false;
+  }
+
+  compressed_.clear();
+  for (const auto& data : chunks_) {
+    compressed_.insert(compressed_.end(), data.begin(), data.end());
+  }
+
+  state_.resize(raw_size_);
+  const int size = tracy::LZ4_decompress_safe(
+      compressed_.data(), reinterpret_cast<char*>(state_.data()),
+      static_cast<int>(compressed_.size()), static_cast<int>(state_.size()));
+  if (size != raw_size_ ||
+      checksum::Crc32c(state_.data(), state_.size()) != checksum_) {
+    return false;
+  }
+
+  StateReader reader(state_);
+  return game.Deserialize(reader);
+}
+
+void StateTransferReceiver::Reset() noexcept {
+  transfer_id_ = -1;
+  frame_nbr_ = -1;
+  chunk_count_ = 0;
+  raw_size_ = 0;
+  checksum_ = 0;
+  for (auto& data : chunks_) {
+    data.clear();
+  }
+  received_chunks_.clear();
+}
@@ -0,0 +1,180 @@
+#include "sync_test.h"
+
+#include <algorithm>
+
+#ifdef TRACY_ENABLE
+#include <TracyC.h>
+
+#include <Tracy.hpp>
+#endif
+
+void SyncTest::Start(int player_count, BallType ball_type, int rollback_depth,
+                     bool is_island_mode) {
+  // Assigning a new game would leave the quad tree nodes with the allocator
+  // of the temporary game, restart it instead.
+  game_.Restart();
+  game_.SetBallType(ball_type);
+  game_.SetPlayerCount(player_count);
+  game_.StartGame();
+
+  player_count_ = player_count;
+  rollback_depth_ =
+      std::clamp(rollback_depth, 1, metrics::kMaxRollbackFrames - 1);
+  current_frame_ = -1;
+  divergent_frame_ = -1;
+  is_island_mode_ = is_island_mode;
+  island_rollback_count_ = 0;
+  whole_rollback_count_ = 0;
+  telemetry_.Reset();
+}
+
+bool SyncTest::AdvanceFrame(const FrameInputs& inputs) noexcept {
+#ifdef TRACY_ENABLE
+  ZoneScoped;
+#endif
+  current_frame_++;
+  inputs_[current_frame_] = inputs;
+
+  SetInputs(current_frame_);
+  game_.Update();
+  checksums_[current_frame_] = game_.CheckSum();
+  snapshots_[current_frame_].Copy(game_);
+
+  // The first frame has no state before it to go back to.
+  const int first_frame = std::max(current_frame_ - rollback_depth_ + 1, 1);
+  bool is_same = true;
+  if (first_frame <= current_frame_) {
+    is_same = DoRollback(first_frame);
+    if (is_same && is_island_mode_) {
+      is_same = CheckIslandRollback(first_frame,
+                                    current_frame_ % player_count_);
+    }
+  }
+
+  telemetry_.EndFrame(current_frame_, first_frame - 1);
+  return is_same;
+}
+
+void SyncTest::SetInputs(int frame_nbr) noexcept {
+  const auto& frame_inputs = inputs_[frame_nbr];
+  for (int player_id = 0; player_id < player_count_; player_id++) {
+    game_.SetPlayerInput(player_id, frame_inputs[player_id]);
+  }
+}
+
+bool SyncTest::DoRollback(int first_frame) noexcept {
+#ifdef TRACY_ENABLE
+  ZoneScoped;
+#endif
+  const auto start_time = RollbackTelemetry::Clock::now();
+
+  game_.Copy(snapshots_[first_frame - 1]);
+  game_.SetResimulating(true);
+
+  bool is_same = true;
+  for (int frame = first_frame; frame <= current_frame_; frame++) {
+    SetInputs(frame);
+    game_.FixedUpdate();
+    snapshots_[frame].Copy(game_);
+
+    if (game_.CheckSum() != checksums_[frame]) {
+      if (divergent_frame_ == -1) {
+        divergent_frame_ = frame;
+      }
+      is_same = false;
+    }
+  }
+
+  game_.SetResimulating(false);
+
+  telemetry_.RecordRollback(current_frame_ - first_frame + 1,
+                            RollbackTelemetry::Clock::now() - start_time);
+  return is_same;
+}
+
+bool SyncTest::CheckIslandRollback(int first_frame, int player_id) noexcept {
+#ifdef TRACY_ENABLE
+  ZoneScoped;
+#endif
+  // Another direction and jump, so the player surely moves differently.
+  constexpr input::Input kChangedBits = input::kLeft | input::kJump;
+  const auto set_inputs = [this, first_frame, player_id](Game& game,
+                                                         int frame) {
+    auto frame_inputs = inputs_[frame];
+    if (frame == first_frame) {
+      frame_inputs[player_id] ^= kChangedBits;
+    }
+    for (int other_id = 0; other_id < player_count_; other_id++) {
+      game.SetPlayerInput(other_id, frame_inputs[other_id]);
+    }
+  };
+
+  const auto& base = snapshots_[first_frame - 1];
+  const BodyMask island =
+      GetIsland(first_frame, snapshots_[first_frame].GetPlayerBodyMask(
+                                 player_id));
+  const auto dynamic_bodies = base.GetDynamicBodyMask();
+
+  whole_game_.Copy(base);
+  whole_game_.SetResimulating(true);
+  island_game_.Copy(base);
+  island_game_.SetResimulating(true);
+
+  // The rollback simulates the whole world when every body is reached.
+  bool is_island = (island & dynamic_bodies) != dynamic_bodies;
+  bool is_same = true;
+  for (int frame = first_frame; frame <= current_frame_; frame++) {
+    set_inputs(whole_game_, frame);
+    whole_game_.FixedUpdate();
+
+    set_inputs(island_game_, frame);
+    if (is_island) {
+      // The rollback keeps the state before the frame in its snapshots.
+      island_snapshot_.Copy(island_game_);
+      if (island_game_.FixedUpdateIsland(island, snapshots_[frame])) {
+        // The kept snapshot holds the rest of the world, simulated with the
+        // same inputs since they only change in the island.
+        island_game_.CopyOutsideIsland(snapshots_[frame], island);
+      } else {
+        // A body left the island, the rest is simulated whole from the state
+        // before this frame.
+        is_island = false;
+        island_game_.Copy(island_snapshot_);
+        set_inputs(island_game_, frame);
+        island_game_.FixedUpdate();
+      }
+    } else {
+      island_game_.FixedUpdate();
+    }
+
+    if (island_game_.CheckSum() != whole_game_.CheckSum()) {
+      if (divergent_frame_ == -1) {
+        divergent_frame_ = frame;
+      }
+      is_same = false;
+    }
+  }
+
+  whole_game_.SetResimulating(false);
+  island_game_.SetResimulating(false);
+  if (is_island) {
+    island_rollback_count_++;
+  } else {
+    whole_rollback_count_++;
+  }
+  return is_same;
+}
+
+BodyMask SyncTest::GetIsland(int first_frame,
+                             BodyMask changed_bodies) const noexcept {
+  // The same search as the rollback, over the kept snapshots.
+  BodyMask island = changed_bodies;
+  BodyMask previous_island = 0;
+  while (island != previous_island) {
+    previous_island = island;
+    for (int frame = first_frame; frame <= current_frame_; frame++) {
+      island = snapshots_[frame].AddInteractingBodies(island);
+    }
+  }
+  return island;
+}
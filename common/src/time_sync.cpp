@@ -0,0 +1,73 @@
+#include "time_sync.h"
+
+#include <algorithm>
+#include <cmath>
+
+void TimeSync::OnRemoteFrame(int player_id, int remote_frame,
+                             int remote_advantage) noexcept {
+  // The packets may arrive out of order.
+  if (remote_frame < remote_frames_[player_id]) {
+    return;
+  }
+  remote_frames_[player_id] = remote_frame;
+  remote_advantages_[player_id] = remote_advantage;
+}
+
+void TimeSync::Update(int local_frame, int round_trip_time) noexcept {
+  // The frames are relayed by the server, so the frame of a remote player
+  // arrives about one of our round trips after it was sent.
+  constexpr float kFrameTime = metrics::kFixedDeltaTime * 1000.f;
+  const int latency_frames = static_cast<int>(
+      std::lround(static_cast<float>(round_trip_time) / kFrameTime));
+
+  for (int player_id = 0; player_id < metrics::kMaxPlayerNbr; player_id++) {
+    if (remote_frames_[player_id] == -1) {
+      continue;
+    }
+
+    local_advantages_[player_id] =
+        local_frame - (remote_frames_[player_id] + latency_frames);
+
+    const int difference =
+        local_advantages_[player_id] - remote_advantages_[player_id];
+    auto& sample_count = sample_counts_[player_id];
+    auto& differences = advantage_differences_[player_id];
+    if (sample_count == kWindowSize) {
+      difference_sums_[player_id] -= differences[local_frame];
+    } else {
+      sample_count++;
+    }
+    differences[local_frame] = difference;
+    difference_sums_[player_id] += difference;
+  }
+}
+
+float TimeSync::GetFrameAdvantage() const noexcept {
+  float advantage = 0.f;
+  for (int player_id = 0; player_id < metrics::kMaxPlayerNbr; player_id++) {
+    if (sample_counts_[player_id] == 0) {
+      continue;
+    }
+    const float average_difference =
+        static_cast<float>(difference_sums_[player_id]) /
+        static_cast<float>(sample_counts_[player_id]);
+    advantage = std::max(advantage, average_difference / 2.f);
+  }
+  return advantage;
+}
+
+float TimeSync::GetStepScale() const noexcept {
+  const float advantage = GetFrameAdvantage();
+  if (advantage < kMinAdvantage) {
+    return 1.f;
+  }
+  return std::min(1.f + advantage * kStretchPerFrame, kMaxStepScale);
+}
+
+void TimeSync::Reset() noexcept {
+  remote_frames_.fill(-1);
+  remote_advantages_.fill(0);
+  local_advantages_.fill(0);
+  difference_sums_.fill(0);
+  sample_counts_.fill(0);
+}
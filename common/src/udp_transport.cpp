@@ -0,0 +1,417 @@
+#include "udp_transport.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace {
+
+void WriteSequence(std::uint8_t* data, std::uint32_t sequence) noexcept {
+  for (int byte = 0; byte < 4; byte++) {
+    data[byte] = static_cast<std::uint8_t>(sequence >> (8 * byte));
+  }
+}
+
+std::uint32_t ReadSequence(const std::uint8_t* data) noexcept {
+  std::uint32_t sequence = 0;
+  for (int byte = 0; byte < 4; byte++) {
+    sequence |= static_cast<std::uint32_t>(data[byte]) << (8 * byte);
+  }
+  return sequence;
+}
+
+// The sequence numbers wrap around, compare them by their distance.
+bool IsBefore(std::uint32_t sequence, std::uint32_t other) noexcept {
+  return static_cast<std::int32_t>(sequence - other) < 0;
+}
+
+}  // namespace
+
+bool UdpTransport::Open(std::uint16_t port) {
+  Close();
+
+  socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_ == -1) {
+    std::cerr << "Could not open the udp socket: " << std::strerror(errno)
+              << '\n';
+    return false;
+  }
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if (bind(socket_, reinterpret_cast<const sockaddr*>(&address),
+           sizeof(address)) == -1 ||
+      fcntl(socket_, F_SETFL, fcntl(socket_, F_GETFL, 0) | O_NONBLOCK) ==
+          -1) {
+    std::cerr << "Could not bind the udp socket to port " << port << ": "
+              << std::strerror(errno) << '\n';
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void UdpTransport::Close() noexcept {
+  if (socket_ != -1) {
+    close(socket_);
+    socket_ = -1;
+  }
+}
+
+std::uint16_t UdpTransport::GetLocalPort() const noexcept {
+  sockaddr_in address{};
+  socklen_t size = sizeof(address);
+  if (socket_ == -1 ||
+      getsockname(socket_, reinterpret_cast<sockaddr*>(&address), &size) ==
+          -1) {
+    return 0;
+  }
+  return ntohs(address.sin_port);
+}
+
+bool UdpTransport::SetPeer(int peer, const char* host, std::uint16_t port,
+                           std::uint32_t first_sequence) {
+  if (peer < 0) {
+    return false;
+  }
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  if (inet_pton(AF_INET, host, &address.sin_addr) != 1) {
+    return false;
+  }
+
+  if (peer >= static_cast<int>(peers_.size())) {
+    peers_.resize(peer + 1);
+  }
+  // A new address is a new connection, the reliable numbering starts again.
+  peers_[peer] = Peer{};
+  peers_[peer].address = address;
+  peers_[peer].is_set = true;
+  peers_[peer].next_send_sequence = first_sequence;
+  peers_[peer].next_receive_sequence = first_sequence;
+  return true;
+}
+
+void UdpTransport::SendUnreliable(int peer, const std::uint8_t* data,
+                                  std::size_t size) {
+  ForEachReceiver(peer, [&](int receiver) {
+    QueueDatagram(receiver, DatagramType::kUnreliable, 0, data, size);
+  });
+}
+
+void UdpTransport::SendReliable(int peer, const std::uint8_t* data,
+                                std::size_t size) {
+  if (kHeaderSize + size > kMaxDatagramSize) {
+    stats_.dropped_packets++;
+    return;
+  }
+
+  const auto now = Clock::now();
+  ForEachReceiver(peer, [&](int receiver) {
+    auto& unacked_packets = peers_[receiver].unacked_packets;
+    auto& pending = unacked_packets.emplace_back();
+    pending.sequence = peers_[receiver].next_send_sequence++;
+    pending.datagram.resize(kHeaderSize + size);
+    pending.datagram[0] = static_cast<std::uint8_t>(DatagramType::kReliable);
+    WriteSequence(pending.datagram.data() + 1, pending.sequence);
+    std::memcpy(pending.datagram.data() + kHeaderSize, data, size);
+
+    // Outside of the window, sent once the first packets are acknowledged.
+    if (unacked_packets.size() <= kSendWindow) {
+      pending.is_sent = true;
+      pending.last_send_time = now;
+      QueueDatagram(receiver, pending.datagram);
+    }
+  });
+}
+
+bool UdpTransport::Receive(TransportPacket& packet) {
+  if (received_packets_.empty()) {
+    return false;
+  }
+  auto& received = received_packets_.front();
+  packet.peer = received.peer;
+  std::swap(packet.data, received.data);
+  // The previous buffer of the caller is kept for a next packet.
+  if (received.data.capacity() > 0) {
+    free_buffers_.push_back(std::move(received.data));
+  }
+  received_packets_.pop_front();
+  return true;
+}
+
+void UdpTransport::Service() {
+  if (socket_ == -1) {
+    return;
+  }
+  ReceiveDatagrams();
+  QueueAcks();
+  QueueResends(Clock::now());
+  SendDatagrams();
+}
+
+void UdpTransport::QueueDatagram(int peer, DatagramType type,
+                                 std::uint32_t sequence,
+                                 const std::uint8_t* data, std::size_t size) {
+  if (kHeaderSize + size > kMaxDatagramSize) {
+    stats_.dropped_packets++;
+    return;
+  }
+  if (send_count_ == send_queue_.size()) {
+    send_queue_.emplace_back();
+  }
+  auto& datagram = send_queue_[send_count_++];
+  datagram.peer = peer;
+  datagram.data.resize(kHeaderSize + size);
+  datagram.data[0] = static_cast<std::uint8_t>(type);
+  WriteSequence(datagram.data.data() + 1, sequence);
+  if (size > 0) {
+    std::memcpy(datagram.data.data() + kHeaderSize, data, size);
+  }
+}
+
+void UdpTransport::QueueDatagram(int peer,
+                                 const std::vector<std::uint8_t>& datagram) {
+  if (send_count_ == send_queue_.size()) {
+    send_queue_.emplace_back();
+  }
+  auto& queued = send_queue_[send_count_++];
+  queued.peer = peer;
+  queued.data.assign(datagram.begin(), datagram.end());
+}
+
+void UdpTransport::ReceiveDatagrams() {
+  std::array<mmsghdr, kBatchSize> messages{};
+  std::array<iovec, kBatchSize> buffers{};
+  std::array<sockaddr_in, kBatchSize> addresses{};
+  std::uniform_real_distribution<float> loss_distribution(0.f, 1.f);
+
+  while (true) {
+    for (int index = 0; index < kBatchSize; index++) {
+      buffers[index].iov_base = receive_buffers_[index].data();
+      buffers[index].iov_len = kMaxDatagramSize;
+      messages[index].msg_hdr = {};
+      messages[index].msg_hdr.msg_iov = &buffers[index];
+      messages[index].msg_hdr.msg_iovlen = 1;
+      messages[index].msg_hdr.msg_name = &addresses[index];
+      messages[index].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+
+    const int count =
+        recvmmsg(socket_, messages.data(), kBatchSize, MSG_DONTWAIT, nullptr);
+    stats_.receive_calls++;
+    if (count <= 0) {
+      // EAGAIN when every datagram is read.
+      return;
+    }
+
+    for (int index = 0; index < count; index++) {
+      stats_.received_datagrams++;
+      const int peer = FindPeer(addresses[index]);
+      if (peer == -1) {
+        continue;
+      }
+      if (loss_rate_ > 0.f &&
+          loss_distribution(random_engine_) < loss_rate_) {
+        stats_.lost_datagrams++;
+        continue;
+      }
+      HandleDatagram(peer, receive_buffers_[index].data(),
+                     messages[index].msg_len);
+    }
+
+    if (count < kBatchSize) {
+      return;
+    }
+  }
+}
+
+void UdpTransport::HandleDatagram(int peer, const std::uint8_t* data,
+                                  std::size_t size) {
+  if (size < kHeaderSize) {
+    return;
+  }
+  const auto type = static_cast<DatagramType>(data[0]);
+  const std::uint32_t sequence = ReadSequence(data + 1);
+  const std::uint8_t* payload = data + kHeaderSize;
+  const std::size_t payload_size = size - kHeaderSize;
+
+  switch (type) {
+    case DatagramType::kUnreliable:
+      AddReceivedPacket(peer, payload, payload_size);
+      break;
+    case DatagramType::kReliable:
+      HandleReliable(peer, sequence, payload, payload_size);
+      break;
+    case DatagramType::kAck:
+      HandleAck(peer, sequence, payload, payload_size);
+      break;
+  }
+}
+
+void UdpTransport::HandleReliable(int peer, std::uint32_t sequence,
+                                  const std::uint8_t* data, std::size_t size) {
+  auto& remote = peers_[peer];
+  // Acknowledge even a duplicate, the previous acknowledgment may be lost.
+  remote.must_ack = true;
+
+  if (IsBefore(sequence, remote.next_receive_sequence)) {
+    return;
+  }
+  if (sequence != remote.next_receive_sequence) {
+    if (remote.out_of_order_packets.size() < kMaxOutOfOrderPackets) {
+      remote.out_of_order_packets[sequence].assign(data, data + size);
+    }
+    return;
+  }
+
+  AddReceivedPacket(peer, data, size);
+  remote.next_receive_sequence++;
+
+  // The packets that arrived before this one can be delivered now.
+  auto it = remote.out_of_order_packets.find(remote.next_receive_sequence);
+  while (it != remote.out_of_order_packets.end()) {
+    auto& next_packet = received_packets_.emplace_back();
+    next_packet.peer = peer;
+    next_packet.data = std::move(it->second);
+    remote.out_of_order_packets.erase(it);
+    remote.next_receive_sequence++;
+    it = remote.out_of_order_packets.find(remote.next_receive_sequence);
+  }
+}
+
+void UdpTransport::AddReceivedPacket(int peer, const std::uint8_t* data,
+                                     std::size_t size) {
+  auto& packet = received_packets_.emplace_back();
+  packet.peer = peer;
+  if (!free_buffers_.empty()) {
+    packet.data = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+  }
+  packet.data.assign(data, data + size);
+}
+
+void UdpTransport::HandleAck(int peer, std::uint32_t next_sequence,
+                             const std::uint8_t* mask,
+                             std::size_t mask_size) noexcept {
+  // Every packet before the next expected one was received.
+  auto& unacked_packets = peers_[peer].unacked_packets;
+  while (!unacked_packets.empty() &&
+         IsBefore(unacked_packets.front().sequence, next_sequence)) {
+    unacked_packets.pop_front();
+  }
+
+  // The packets received after a lost one are not sent again with it.
+  for (auto& pending : unacked_packets) {
+    // The next expected packet is not in the mask.
+    if (pending.sequence == next_sequence) {
+      continue;
+    }
+    const std::uint32_t offset = pending.sequence - next_sequence - 1;
+    if (offset >= mask_size * 8) {
+      break;
+    }
+    if ((mask[offset / 8] >> (offset % 8)) & 1) {
+      pending.is_acked = true;
+    }
+  }
+}
+
+void UdpTransport::QueueAcks() {
+  for (int peer = 0; peer < static_cast<int>(peers_.size()); peer++) {
+    auto& remote = peers_[peer];
+    if (!remote.must_ack) {
+      continue;
+    }
+    ack_mask_.fill(0);
+    for (const auto& [sequence, packet] : remote.out_of_order_packets) {
+      const std::uint32_t offset =
+          sequence - remote.next_receive_sequence - 1;
+      if (offset < kMaxOutOfOrderPackets) {
+        ack_mask_[offset / 8] |= static_cast<std::uint8_t>(1 << (offset % 8));
+      }
+    }
+    QueueDatagram(peer, DatagramType::kAck, remote.next_receive_sequence,
+                  ack_mask_.data(), ack_mask_.size());
+    remote.must_ack = false;
+  }
+}
+
+void UdpTransport::QueueResends(Clock::time_point now) {
+  for (int peer = 0; peer < static_cast<int>(peers_.size()); peer++) {
+    auto& unacked_packets = peers_[peer].unacked_packets;
+    const std::size_t window_size =
+        std::min(unacked_packets.size(), kSendWindow);
+    for (std::size_t index = 0; index < window_size; index++) {
+      auto& pending = unacked_packets[index];
+      if (pending.is_acked) {
+        continue;
+      }
+      if (pending.is_sent) {
+        if (now - pending.last_send_time < kResendDelay) {
+          continue;
+        }
+        stats_.resent_packets++;
+      }
+      // The packets that entered the window are sent for the first time.
+      pending.is_sent = true;
+      pending.last_send_time = now;
+      QueueDatagram(peer, pending.datagram);
+    }
+  }
+}
+
+void UdpTransport::SendDatagrams() {
+  std::array<mmsghdr, kBatchSize> messages{};
+  std::array<iovec, kBatchSize> buffers{};
+
+  std::size_t first = 0;
+  while (first < send_count_) {
+    const int count =
+        static_cast<int>(std::min<std::size_t>(send_count_ - first,
+                                               kBatchSize));
+    for (int index = 0; index < count; index++) {
+      auto& datagram = send_queue_[first + index];
+      buffers[index].iov_base = datagram.data.data();
+      buffers[index].iov_len = datagram.data.size();
+      messages[index].msg_hdr = {};
+      messages[index].msg_hdr.msg_iov = &buffers[index];
+      messages[index].msg_hdr.msg_iovlen = 1;
+      messages[index].msg_hdr.msg_name = &peers_[datagram.peer].address;
+      messages[index].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+
+    const int sent = sendmmsg(socket_, messages.data(), count, 0);
+    stats_.send_calls++;
+    if (sent <= 0) {
+      // The socket buffer is full: the unreliable datagrams are lost and the
+      // reliable ones are sent again later.
+      stats_.dropped_packets += static_cast<long long>(send_count_ - first);
+      break;
+    }
+    stats_.sent_datagrams += sent;
+    first += sent;
+  }
+  send_count_ = 0;
+}
+
+int UdpTransport::FindPeer(const sockaddr_in& address) const noexcept {
+  for (int peer = 0; peer < static_cast<int>(peers_.size()); peer++) {
+    const auto& remote = peers_[peer];
+    if (remote.is_set &&
+        remote.address.sin_addr.s_addr == address.sin_addr.s_addr &&
+        remote.address.sin_port == address.sin_port) {
+      return peer;
+    }
+  }
+  return -1;
+}
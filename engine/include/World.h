@@ -3,6 +3,7 @@
 #include "Body.h"
 #include "Contact.h"
 #include "QuadTree.h"
+#include <cstdint>
 #include <vector>
 #include <unordered_set>
 
@@ -21,10 +22,19 @@ private:
 
 	ContactListener* _contactListener = nullptr; /**< A listener for contact events between colliders. */
 
+	std::vector<Math::RectangleF> _colliderBounds; /**< The bounds of the colliders computed by the last broadphase refresh. */
+	bool _areStaticBoundsDirty = true; /**< Flag indicating if the bounds of the static colliders must be recomputed. */
+	bool _isLightweight = false; /**< Flag indicating if the world skips what is only needed for observability. */
+	std::uint32_t _structureVersion = 0; /**< Incremented every time a body or a collider is created or destroyed. */
+	std::uint64_t _islandMask = 0; /**< The bodies updated by UpdateIsland, by the bit of their index. */
+	bool _isIslandUpdate = false; /**< Flag indicating if only the pairs involving a body of the island are tested. */
+	bool _hasLeftIsland = false; /**< Flag indicating if a body of the island touched a dynamic body outside of it. */
+	const World* _islandOutside = nullptr; /**< The world where the bodies outside of the island were simulated. */
+
 public:
 	std::vector<size_t> BodyGenIndices; /**< Indices of generated bodies. */
 	std::vector<size_t> ColliderGenIndices; /**< Indices of generated colliders. */
-	QuadTree QuadTree{};/**< QuadTree for collision checks */
+	::QuadTree QuadTree{};/**< QuadTree for collision checks */
 	/**
 	 * @brief Default constructor for the _world class.
 	 */
@@ -46,6 +56,37 @@ public:
 	 */
 	void Update(const float deltaTime) noexcept;
 
+	/**
+	 * @brief Update only an island of bodies over a time step, used to resimulate the part of the world that changed.
+	 * @note The bodies are integrated and the quad tree is built as in Update, so the pairs are visited in the same order,
+	 * but only the pairs involving a body of the island are tested. The state of the other dynamic bodies is not
+	 * meaningful afterwards, it must be copied from a world where they were simulated, see CopyOutsideIsland.
+	 * @param deltaTime The time step for the simulation.
+	 * @param islandMask The bit of the index of each body of the island, only the first 64 bodies can be in an island.
+	 * @param outside A world where the bodies outside of the island were simulated over the same step.
+	 * @return false if a body of the island touched a dynamic body outside of it, the update is then not valid.
+	 */
+	[[nodiscard]] bool UpdateIsland(const float deltaTime, std::uint64_t islandMask, const World& outside) noexcept;
+
+	/**
+	 * @brief Copy the bodies outside of an island, the position of their colliders and the overlapping pairs
+	 * that do not involve the island from another world.
+	 * @note Both worlds must have the same structure, only the state of the bodies differs.
+	 * @param other The world to copy from.
+	 * @param islandMask The bit of the index of each body of the island.
+	 */
+	void CopyOutsideIsland(const World& other, std::uint64_t islandMask) noexcept;
+
+	/**
+	 * @brief Check if a body is in an island.
+	 * @param bodyIndex The index of the body.
+	 * @param islandMask The bit of the index of each body of the island.
+	 * @return true if the bit of the body is set.
+	 */
+	[[nodiscard]] static bool IsInIsland(std::size_t bodyIndex, std::uint64_t islandMask) noexcept {
+		return bodyIndex < 64 && ((islandMask >> bodyIndex) & 1) != 0;
+	}
+
 	/**
 	 * @brief Create a new body in the world.
 	 * @return A reference to the created body.
@@ -85,6 +126,19 @@ public:
 	 */
 	void DestroyCollider(const ColliderRef colRef);
 
+	/**
+	 * @brief Replace the whole state of the world, used to restore a saved state.
+	 * @note The quad tree and the bounds are computed again by the next update.
+	 * @param bodies The bodies in index order, including the disabled ones.
+	 * @param bodyGenIndices The generation index of each body.
+	 * @param colliders The colliders in index order, including the ones that are not attached.
+	 * @param colliderGenIndices The generation index of each collider.
+	 * @param colRefPairs The pairs of colliders that are currently overlapping.
+	 */
+	void Restore(std::vector<Body> bodies, std::vector<size_t> bodyGenIndices,
+		std::vector<Collider> colliders, std::vector<size_t> colliderGenIndices,
+		const std::vector<ColliderRefPair>& colRefPairs);
+
 	/**
 	 * @brief Set a contact listener to receive collision events.
 	 * @param listener A pointer to the contact listener object.
@@ -92,6 +146,41 @@ public:
 	void SetContactListener(ContactListener* listener) {
 		_contactListener = listener;
 	}
+
+	/**
+	 * @brief Enable or disable the lightweight mode, used when the world is resimulated and only its final state is observed.
+	 * @note In lightweight mode the profiler texts and the collision exit events are skipped,
+	 * and the bounds of the static colliders are reused from the previous update, so static bodies must not move.
+	 * @param isLightweight True to enable the lightweight mode.
+	 */
+	void SetLightweight(bool isLightweight) noexcept {
+		_isLightweight = isLightweight;
+	}
+
+	/**
+	 * @brief Get all the bodies of the world, including the disabled ones.
+	 * @return The bodies in index order.
+	 */
+	[[nodiscard]] const std::vector<Body>& GetBodies() const noexcept { return _bodies; }
+
+	/**
+	 * @brief Get all the colliders of the world, including the ones that are not attached.
+	 * @return The colliders in index order.
+	 */
+	[[nodiscard]] const std::vector<Collider>& GetColliders() const noexcept { return _colliders; }
+
+	/**
+	 * @brief Get the pairs of colliders that are currently overlapping.
+	 * @return The set of overlapping colliderRef pairs, its iteration order is not specified.
+	 */
+	[[nodiscard]] const auto& GetColliderRefPairs() const noexcept { return _colRefPairs; }
+
+	/**
+	 * @brief Get the version of the structure of the world.
+	 * @note Two worlds with the same history of created and destroyed bodies and colliders have the same version.
+	 * @return A number that changes every time a body or a collider is created or destroyed.
+	 */
+	[[nodiscard]] std::uint32_t GetStructureVersion() const noexcept { return _structureVersion; }
 private:
 	/**
 	 * @brief Updates all the bodies.
@@ -108,6 +197,18 @@ private:
 	 */
 	void UpdateQuadTreeCollisions(const QuadNode& node)noexcept;
 
+	/**
+	 * @brief Check if a pair of colliders must be skipped by an island update.
+	 * @note A pair between the island and a dynamic body outside of it that may overlap, or that was overlapping,
+	 * marks the update as not valid. The contacts of the outside body are skipped, so it is only known to be
+	 * between its integrated position and its position at the end of the step in the outside world.
+	 * @param col1 The first collider.
+	 * @param col2 The second collider.
+	 * @param colPair The references of the colliders.
+	 * @return true if the pair does not involve the island or crosses its border.
+	 */
+	[[nodiscard]] bool IsOutsideIsland(const Collider& col1, const Collider& col2, const ColliderRefPair& colPair) noexcept;
+
 	/**
 	 * @brief Check if two colliders overlap.
 	 * @param colA The first collider.
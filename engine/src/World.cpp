@@ -1,5 +1,7 @@
 #include "World.h"
 
+#include <algorithm>
+
 #ifdef TRACY_ENABLE
 #include <TracyC.h>
 #include <fmt/format.h>
@@ -23,6 +25,28 @@ void World::TearDown() noexcept {
   ColliderGenIndices.clear();
 
   _colRefPairs.clear();
+
+  _colliderBounds.clear();
+  _areStaticBoundsDirty = true;
+  _structureVersion++;
+}
+
+void World::Restore(std::vector<Body> bodies,
+                    std::vector<size_t> bodyGenIndices,
+                    std::vector<Collider> colliders,
+                    std::vector<size_t> colliderGenIndices,
+                    const std::vector<ColliderRefPair>& colRefPairs) {
+  _bodies = std::move(bodies);
+  BodyGenIndices = std::move(bodyGenIndices);
+  _colliders = std::move(colliders);
+  ColliderGenIndices = std::move(colliderGenIndices);
+
+  _colRefPairs.clear();
+  _colRefPairs.insert(colRefPairs.begin(), colRefPairs.end());
+
+  _colliderBounds.clear();
+  _areStaticBoundsDirty = true;
+  _structureVersion++;
 }
 
 void World::Update(const float deltaTime) noexcept {
@@ -36,12 +60,74 @@ void World::Update(const float deltaTime) noexcept {
   UpdateQuadTreeCollisions(QuadTree.Nodes[0]);
 }
 
+bool World::UpdateIsland(const float deltaTime, std::uint64_t islandMask,
+                         const World& outside) noexcept {
+#ifdef TRACY_ENABLE
+  ZoneScoped;
+#endif
+  _islandMask = islandMask;
+  _islandOutside = &outside;
+  _isIslandUpdate = true;
+  _hasLeftIsland = false;
+
+  // The bodies outside of the island are integrated too, their bounds must be
+  // the same as in a full update to build the same quad tree.
+  UpdateBodies(deltaTime);
+
+  SetUpQuadTree();
+
+  UpdateQuadTreeCollisions(QuadTree.Nodes[0]);
+
+  _isIslandUpdate = false;
+  _islandOutside = nullptr;
+  return !_hasLeftIsland;
+}
+
+void World::CopyOutsideIsland(const World& other,
+                              std::uint64_t islandMask) noexcept {
+  for (std::size_t i = 0; i < _bodies.size(); ++i) {
+    if (!IsInIsland(i, islandMask)) {
+      _bodies[i] = other._bodies[i];
+    }
+  }
+
+  for (std::size_t i = 0; i < _colliders.size(); ++i) {
+    auto& collider = _colliders[i];
+    if (collider.IsAttached &&
+        !IsInIsland(collider.BodyRef.Index, islandMask)) {
+      collider.BodyPosition = other._colliders[i].BodyPosition;
+    }
+  }
+
+  const auto isOutside = [this, islandMask](const ColliderRefPair& colPair) {
+    return !IsInIsland(_colliders[colPair.ColRefA.Index].BodyRef.Index,
+                       islandMask) &&
+           !IsInIsland(_colliders[colPair.ColRefB.Index].BodyRef.Index,
+                       islandMask);
+  };
+  for (auto it = _colRefPairs.begin(); it != _colRefPairs.end();) {
+    if (isOutside(*it)) {
+      it = _colRefPairs.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (const auto& colPair : other._colRefPairs) {
+    if (isOutside(colPair)) {
+      _colRefPairs.emplace(colPair);
+    }
+  }
+}
+
 [[nodiscard]] BodyRef World::CreateBody() noexcept {
   const auto it =
       std::find_if(_bodies.begin(), _bodies.end(), [](const Body& body) {
         return !body.IsEnabled();  // Get first disabled body
       });
 
+  _areStaticBoundsDirty = true;
+  _structureVersion++;
+
   if (it != _bodies.end()) {
     const std::size_t index = std::distance(_bodies.begin(), it);
     const auto bodyRef = BodyRef{index, BodyGenIndices[index]};
@@ -65,6 +151,8 @@ void World::DestroyBody(const BodyRef bodyRef) {
   }
 
   _bodies[bodyRef.Index].Disable();
+  _areStaticBoundsDirty = true;
+  _structureVersion++;
 }
 
 [[nodiscard]] Body& World::GetBody(const BodyRef bodyRef) {
@@ -81,6 +169,9 @@ ColliderRef World::CreateCollider(const BodyRef bodyRef) noexcept {
         return !collider.IsAttached;  // Get first disabled collider
       });
 
+  _areStaticBoundsDirty = true;
+  _structureVersion++;
+
   if (it != _colliders.end()) {
     const std::size_t index = std::distance(_colliders.begin(), it);
     const auto colRef = ColliderRef{index, ColliderGenIndices[index]};
@@ -116,6 +207,8 @@ void World::DestroyCollider(const ColliderRef colRef) {
     throw std::runtime_error("No collider found !");
   }
   _colliders[colRef.Index].IsAttached = false;
+  _areStaticBoundsDirty = true;
+  _structureVersion++;
 }
 
 void World::UpdateBodies(const float deltaTime) noexcept {
@@ -146,20 +239,33 @@ void World::SetUpQuadTree() noexcept {
   Math::Vec2F minBounds(std::numeric_limits<float>::max(),
                         std::numeric_limits<float>::max());
 
-  for (auto& collider : _colliders) {
+  // The static colliders do not move, in lightweight mode their bounds are
+  // reused from the previous update.
+  const bool reuseStaticBounds = _isLightweight && !_areStaticBoundsDirty;
+  _colliderBounds.resize(
+      _colliders.size(),
+      Math::RectangleF(Math::Vec2F::Zero(), Math::Vec2F::Zero()));
+
+  for (std::size_t i = 0; i < _colliders.size(); ++i) {
+    auto& collider = _colliders[i];
     if (!collider.IsAttached) {
       continue;
     }
 
-    collider.BodyPosition = GetBody(collider.BodyRef).Position;
+    const auto& body = GetBody(collider.BodyRef);
+    if (!reuseStaticBounds || body.Type != BodyType::STATIC) {
+      collider.BodyPosition = body.Position;
+      _colliderBounds[i] = collider.GetBounds();
+    }
 
-    const auto bounds = collider.GetBounds();
+    const auto& bounds = _colliderBounds[i];
 
     minBounds.X = std::min(minBounds.X, bounds.MinBound().X);
     minBounds.Y = std::min(minBounds.Y, bounds.MinBound().Y);
     maxBounds.X = std::max(maxBounds.X, bounds.MaxBound().X);
     maxBounds.Y = std::max(maxBounds.Y, bounds.MaxBound().Y);
   }
+  _areStaticBoundsDirty = false;
 
   QuadTree.SetUpRoot(Math::RectangleF(minBounds, maxBounds));
 #ifdef TRACY_ENABLE
@@ -168,7 +274,7 @@ void World::SetUpQuadTree() noexcept {
   for (std::size_t i = 0; i < _colliders.size(); ++i) {
     if (_colliders[i].IsAttached) {
       QuadTree.Insert(QuadTree.Nodes[0],
-                      {_colliders[i].GetBounds(), {i, ColliderGenIndices[i]}});
+                      {_colliderBounds[i], {i, ColliderGenIndices[i]}});
     }
   }
 }
@@ -189,6 +295,12 @@ void World::UpdateQuadTreeCollisions(const QuadNode& node) noexcept {
         if (col1.BodyRef == col2.BodyRef) {
           continue;
         }
+        if (_isIslandUpdate &&
+            IsOutsideIsland(col1, col2,
+                            {node.ColliderRefAabbs[i].ColRef,
+                             node.ColliderRefAabbs[j].ColRef})) {
+          continue;
+        }
 
         if (!col2.IsTrigger && !col1.IsTrigger)  // Physical collision
         {
@@ -203,7 +315,7 @@ void World::UpdateQuadTreeCollisions(const QuadNode& node) noexcept {
                   node.ColliderRefAabbs[j].ColRef);
             }
           } else {
-            if (_contactListener != nullptr) {
+            if (_contactListener != nullptr && !_isLightweight) {
               _contactListener->OnCollisionExit(
                   node.ColliderRefAabbs[i].ColRef,
                   node.ColliderRefAabbs[j].ColRef);
@@ -240,6 +352,52 @@ void World::UpdateQuadTreeCollisions(const QuadNode& node) noexcept {
   }
 }
 
+bool World::IsOutsideIsland(const Collider& col1, const Collider& col2,
+                            const ColliderRefPair& colPair) noexcept {
+  const bool isCol1InIsland = IsInIsland(col1.BodyRef.Index, _islandMask);
+  const bool isCol2InIsland = IsInIsland(col2.BodyRef.Index, _islandMask);
+  if (isCol1InIsland == isCol2InIsland) {
+    return !isCol1InIsland;
+  }
+
+  // The static bodies never move, they are the same inside and outside of
+  // the island.
+  const auto& outsideCol = isCol1InIsland ? col2 : col1;
+  if (GetBody(outsideCol.BodyRef).Type == BodyType::STATIC) {
+    return false;
+  }
+
+  // A contact with the rest of the world would change both sides, the island
+  // is not independent anymore.
+  if (_colRefPairs.find(colPair) != _colRefPairs.end()) {
+    _hasLeftIsland = true;
+    return true;
+  }
+
+  // In a full update, the outside body may already have been pushed by its
+  // own contacts when the pair is tested, anywhere from its integrated
+  // position to its final one. The island body is where it would be.
+  const auto& insideCol = isCol1InIsland ? col1 : col2;
+  Collider movedInsideCol = insideCol;
+  movedInsideCol.BodyPosition = GetBody(insideCol.BodyRef).Position;
+  const auto insideBounds = movedInsideCol.GetBounds();
+
+  Collider finalOutsideCol = outsideCol;
+  finalOutsideCol.BodyPosition =
+      _islandOutside->_bodies[outsideCol.BodyRef.Index].Position;
+  const auto integratedBounds = outsideCol.GetBounds();
+  const auto finalBounds = finalOutsideCol.GetBounds();
+  const Math::RectangleF outsideBounds(
+      {std::min(integratedBounds.MinBound().X, finalBounds.MinBound().X),
+       std::min(integratedBounds.MinBound().Y, finalBounds.MinBound().Y)},
+      {std::max(integratedBounds.MaxBound().X, finalBounds.MaxBound().X),
+       std::max(integratedBounds.MaxBound().Y, finalBounds.MaxBound().Y)});
+  if (Math::Intersect(insideBounds, outsideBounds)) {
+    _hasLeftIsland = true;
+  }
+  return true;
+}
+
 [[nodiscard]] bool World::Overlap(const Collider& colA,
                                   const Collider& colB) noexcept {
   const auto ShapeA = static_cast<Math::ShapeType>(colA.Shape.index());
@@ -247,12 +405,14 @@ void World::UpdateQuadTreeCollisions(const QuadNode& node) noexcept {
 
 #ifdef TRACY_ENABLE
   ZoneScoped;
-  static constexpr const char* names[] = {"Circle", "Rectangle", "Polygon",
-                                          "None"};
-  const auto log =
-      fmt::format("Shape A: {}, Shape B: {}", names[static_cast<int>(ShapeA)],
-                  names[static_cast<int>(ShapeB)]);
-  ZoneText(log.data(), log.size());
+  if (!_isLightweight) {
+    static constexpr const char* names[] = {"Circle", "Rectangle", "Polygon",
+                                            "None"};
+    const auto log =
+        fmt::format("Shape A: {}, Shape B: {}", names[static_cast<int>(ShapeA)],
+                    names[static_cast<int>(ShapeB)]);
+    ZoneText(log.data(), log.size());
+  }
 #endif
 
   switch (ShapeA) {
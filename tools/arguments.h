@@ -0,0 +1,28 @@
+#pragma once
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @brief Parses a whole command line argument as a number.
+ * @return false if the argument is not a number of the type or does not fit
+ * in it, the value is then left unchanged.
+ */
+template <typename T>
+bool ParseArgument(const char* argument, T& value) {
+  const char* end = argument + std::strlen(argument);
+  if constexpr (std::is_floating_point_v<T>) {
+    char* parsed_end = nullptr;
+    const double parsed = std::strtod(argument, &parsed_end);
+    if (parsed_end == argument || parsed_end != end) {
+      return false;
+    }
+    value = static_cast<T>(parsed);
+    return true;
+  } else {
+    const auto [parsed_end, error] = std::from_chars(argument, end, value);
+    return error == std::errc{} && parsed_end == end;
+  }
+}
@@ -0,0 +1,259 @@
+// Compares the desync dumps written by two clients: the fields of their
+// states that differ, and the first frame where each client diverged from an
+// offline simulation of the confirmed inputs.
+//
+// Usage: desync_diff <dump of the master client> <dump of the other client>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Game.h"
+#include "desync_dump.h"
+#include "state_reader.h"
+#include "state_writer.h"
+
+namespace {
+
+using StateFields = std::map<std::string, std::string>;
+
+std::string FormatFloat(float value) {
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  std::ostringstream stream;
+  stream.precision(9);
+  stream << value << " (0x" << std::hex << bits << ')';
+  return stream.str();
+}
+
+void AddVec2(StateFields& fields, const std::string& name, Math::Vec2F value) {
+  fields[name + ".x"] = FormatFloat(value.X);
+  fields[name + ".y"] = FormatFloat(value.Y);
+}
+
+/**
+ * @brief Reads a state written by Game::Serialize into a list of named
+ * fields.
+ * @return false if the state is truncated.
+ */
+bool ReadStateFields(const std::vector<std::uint8_t>& state,
+                     StateFields& fields) {
+  StateReader reader(state);
+
+  const auto body_count = reader.ReadU32();
+  for (std::uint32_t index = 0; index < body_count && !reader.HasFailed();
+       index++) {
+    const auto name = "body " + std::to_string(index);
+    fields[name + ".gen_index"] = std::to_string(reader.ReadU32());
+
+    const auto body = reader.ReadBody();
+    fields[name + ".mass"] = FormatFloat(body.Mass);
+    if (body.IsEnabled()) {
+      fields[name + ".type"] = std::to_string(static_cast<int>(body.Type));
+      AddVec2(fields, name + ".position", body.Position);
+      AddVec2(fields, name + ".velocity", body.Velocity);
+      AddVec2(fields, name + ".force", body.GetForce());
+    }
+  }
+
+  const auto collider_count = reader.ReadU32();
+  for (std::uint32_t index = 0; index < collider_count && !reader.HasFailed();
+       index++) {
+    const auto name = "collider " + std::to_string(index);
+    fields[name + ".gen_index"] = std::to_string(reader.ReadU32());
+
+    const auto collider = reader.ReadCollider();
+    fields[name + ".is_attached"] = std::to_string(collider.IsAttached);
+    if (collider.IsAttached) {
+      fields[name + ".body"] = std::to_string(collider.BodyRef.Index) + ":" +
+                               std::to_string(collider.BodyRef.GenIndex);
+      AddVec2(fields, name + ".body_position", collider.BodyPosition);
+      fields[name + ".restitution"] = FormatFloat(collider.Restitution);
+      fields[name + ".is_trigger"] = std::to_string(collider.IsTrigger);
+      fields[name + ".shape"] = std::to_string(collider.Shape.index());
+    }
+  }
+
+  const auto contact_count = reader.ReadU32();
+  fields["contacts.count"] = std::to_string(contact_count);
+  for (std::uint32_t contact = 0;
+       contact < contact_count && !reader.HasFailed(); contact++) {
+    std::string pair;
+    for (int ref = 0; ref < 4; ref++) {
+      pair += std::to_string(reader.ReadU32()) + (ref == 3 ? "" : ":");
+    }
+    fields["contact " + std::to_string(contact)] = pair;
+  }
+
+  const auto player_count = reader.ReadInt();
+  for (int player_id = 0; player_id < player_count && !reader.HasFailed();
+       player_id++) {
+    const auto name = "player " + std::to_string(player_id);
+    fields[name + ".input"] = std::to_string(reader.ReadU8());
+    fields[name + ".is_grounded"] = std::to_string(reader.ReadBool());
+    fields[name + ".kick_time"] = FormatFloat(reader.ReadFloat());
+    fields[name + ".can_kick"] = std::to_string(reader.ReadBool());
+  }
+
+  for (int team = 0; team < static_cast<int>(Team::kCount); team++) {
+    fields["score " + std::to_string(team)] = std::to_string(reader.ReadInt());
+  }
+
+  return !reader.HasFailed();
+}
+
+void PrintFieldDiff(const StateFields& fields_a, const std::string& name_a,
+                    const StateFields& fields_b, const std::string& name_b) {
+  int diff_count = 0;
+
+  for (const auto& [field, value_a] : fields_a) {
+    const auto it = fields_b.find(field);
+    const auto value_b = it == fields_b.end() ? "missing" : it->second;
+    if (value_a != value_b) {
+      std::cout << "  " << field << ": " << name_a << " = " << value_a << ", "
+                << name_b << " = " << value_b << '\n';
+      diff_count++;
+    }
+  }
+  for (const auto& [field, value_b] : fields_b) {
+    if (fields_a.find(field) == fields_a.end()) {
+      std::cout << "  " << field << ": " << name_a << " = missing, " << name_b
+                << " = " << value_b << '\n';
+      diff_count++;
+    }
+  }
+
+  std::cout << "  " << diff_count << " different fields\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    std::cerr << "Usage: desync_diff <dump a> <dump b>\n";
+    return EXIT_FAILURE;
+  }
+
+  DesyncDump dumps[2];
+  for (int i = 0; i < 2; i++) {
+    if (!dumps[i].Load(argv[i + 1])) {
+      std::cerr << "Could not read the desync dump " << argv[i + 1] << '\n';
+      return EXIT_FAILURE;
+    }
+    std::cout << argv[i + 1] << ": player " << dumps[i].player_nbr
+              << ", desync at frame " << dumps[i].frame_nbr << ", "
+              << dumps[i].confirmed_frames.size() << " confirmed frames"
+              << (dumps[i].state.empty() ? ", no state" : "") << '\n';
+  }
+
+  const auto& dump_a = dumps[0];
+  const auto& dump_b = dumps[1];
+  const std::string name_a = "player " + std::to_string(dump_a.player_nbr);
+  const std::string name_b = "player " + std::to_string(dump_b.player_nbr);
+
+  if (dump_a.player_count != dump_b.player_count ||
+      dump_a.ball_type != dump_b.ball_type) {
+    std::cerr << "The dumps do not come from the same game.\n";
+    return EXIT_FAILURE;
+  }
+
+  StateFields fields_a;
+  StateFields fields_b;
+  const bool has_fields_a =
+      !dump_a.state.empty() && ReadStateFields(dump_a.state, fields_a);
+  const bool has_fields_b =
+      !dump_b.state.empty() && ReadStateFields(dump_b.state, fields_b);
+  if (has_fields_a && has_fields_b && dump_a.frame_nbr == dump_b.frame_nbr) {
+    std::cout << "Fields that differ at frame " << dump_a.frame_nbr << ":\n";
+    PrintFieldDiff(fields_a, name_a, fields_b, name_b);
+  }
+
+  // Simulate the confirmed inputs again and compare every frame with the
+  // checksums computed by both clients.
+  Game replay;
+  replay.SetBallType(dump_a.ball_type);
+  replay.SetPlayerCount(dump_a.player_count);
+  replay.StartGame();
+  replay.SetResimulating(true);
+
+  const auto frame_count = std::min(dump_a.confirmed_frames.size(),
+                                    dump_b.confirmed_frames.size());
+  int divergent_frames[2] = {-1, -1};
+  int replayed_frame = -1;
+
+  for (std::size_t i = 0; i < frame_count; i++) {
+    const auto& frame_a = dump_a.confirmed_frames[i];
+    const auto& frame_b = dump_b.confirmed_frames[i];
+    if (frame_a.frame_nbr != static_cast<int>(i) ||
+        frame_b.frame_nbr != static_cast<int>(i)) {
+      std::cout << "The confirmed frame " << i << " is missing.\n";
+      break;
+    }
+
+    bool are_inputs_same = true;
+    for (int player_id = 0; player_id < dump_a.player_count; player_id++) {
+      if (frame_a.inputs[player_id] != frame_b.inputs[player_id]) {
+        std::cout << "The input of player " << player_id << " differs at frame "
+                  << i << '\n';
+        are_inputs_same = false;
+      }
+      replay.SetPlayerInput(player_id, frame_a.inputs[player_id]);
+    }
+    if (!are_inputs_same) {
+      break;
+    }
+
+    replay.FixedUpdate();
+    replayed_frame = frame_a.frame_nbr;
+
+    const int checksum = replay.CheckSum();
+    const int client_checksums[2] = {frame_a.checksum, frame_b.checksum};
+    for (int client = 0; client < 2; client++) {
+      if (divergent_frames[client] == -1 &&
+          client_checksums[client] != checksum) {
+        divergent_frames[client] = frame_a.frame_nbr;
+      }
+    }
+  }
+
+  for (int client = 0; client < 2; client++) {
+    std::cout << "player " << dumps[client].player_nbr;
+    if (divergent_frames[client] == -1) {
+      std::cout << " matches the replay up to frame " << replayed_frame
+                << '\n';
+    } else {
+      std::cout << " first diverges from the replay at frame "
+                << divergent_frames[client] << '\n';
+    }
+  }
+
+  // Show which fields of each client differ from the replayed state.
+  StateWriter writer;
+  replay.Serialize(writer);
+  StateFields replay_fields;
+  ReadStateFields(
+      std::vector<std::uint8_t>(writer.GetData(),
+                                writer.GetData() + writer.GetSize()),
+      replay_fields);
+
+  const bool has_fields[2] = {has_fields_a, has_fields_b};
+  const StateFields* client_fields[2] = {&fields_a, &fields_b};
+  for (int client = 0; client < 2; client++) {
+    if (has_fields[client] && dumps[client].frame_nbr == replayed_frame) {
+      std::cout << "Fields of player " << dumps[client].player_nbr
+                << " that differ from the replay at frame " << replayed_frame
+                << ":\n";
+      PrintFieldDiff(*client_fields[client],
+                     "player " + std::to_string(dumps[client].player_nbr),
+                     replay_fields, "replay");
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
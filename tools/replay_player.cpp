@@ -0,0 +1,56 @@
+// Simulates a recorded match again as fast as possible, without a window,
+// and checks the checksums kept in the replay. Also used as a benchmark of
+// the simulation.
+//
+// Usage: replay_player <replay> [repeat count]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "Game.h"
+#include "arguments.h"
+#include "replay.h"
+
+int main(int argc, char* argv[]) {
+  int repeat_count = 1;
+  if ((argc != 2 && argc != 3) ||
+      (argc == 3 && !ParseArgument(argv[2], repeat_count))) {
+    std::cerr << "Usage: replay_player <replay> [repeat count]\n";
+    return EXIT_FAILURE;
+  }
+  repeat_count = std::max(repeat_count, 1);
+
+  Replay replay;
+  if (!replay.Load(argv[1])) {
+    std::cerr << "Could not read the replay " << argv[1] << '\n';
+    return EXIT_FAILURE;
+  }
+  std::cout << argv[1] << ": " << replay.player_count << " players, "
+            << replay.GetFrameCount() << " frames, recorded by player "
+            << replay.player_nbr << '\n';
+
+  Game game;
+  const auto start_time = std::chrono::steady_clock::now();
+
+  for (int repeat = 0; repeat < repeat_count; repeat++) {
+    const int divergent_frame = replay.Play(game);
+    if (divergent_frame != -1) {
+      std::cout << "The checksum of frame " << divergent_frame
+                << " differs from the replay\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  const std::chrono::duration<double> duration =
+      std::chrono::steady_clock::now() - start_time;
+  const double frame_count =
+      static_cast<double>(replay.GetFrameCount()) * repeat_count;
+  std::cout << "Every checksum matches, " << frame_count << " frames in "
+            << duration.count() << " s, " << frame_count / duration.count()
+            << " frames/s\n";
+
+  return EXIT_SUCCESS;
+}
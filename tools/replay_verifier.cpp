@@ -0,0 +1,165 @@
+// Plays every replay of a directory on all the cores, one game per thread,
+// and reports the throughput and the checksum mismatches of each replay.
+// Used to check an engine change against many recorded matches.
+//
+// Usage: replay_verifier <directory> [thread count]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+// Must be included after windows.h.
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "Game.h"
+#include "arguments.h"
+#include "replay.h"
+
+namespace {
+
+struct ReplayResult {
+  std::filesystem::path path{};
+  bool is_loaded = false;
+  int frame_count = 0;
+  // The first frame whose checksum differs, -1 if every checksum matches.
+  int divergent_frame = -1;
+  double seconds = 0.0;
+};
+
+/**
+ * @brief Gets the largest amount of memory used by the process, in
+ * kilobytes.
+ */
+std::size_t GetPeakMemory() noexcept {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters{};
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                            sizeof(counters))) {
+    return 0;
+  }
+  return counters.PeakWorkingSetSize / 1024;
+#else
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  // Linux gives kilobytes, macOS gives bytes.
+#ifdef __APPLE__
+  return static_cast<std::size_t>(usage.ru_maxrss) / 1024;
+#else
+  return static_cast<std::size_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+void VerifyReplay(ReplayResult& result, Game& game) {
+  Replay replay;
+  if (!replay.Load(result.path.string())) {
+    return;
+  }
+  result.is_loaded = true;
+  result.frame_count = replay.GetFrameCount();
+
+  const auto start_time = std::chrono::steady_clock::now();
+  result.divergent_frame = replay.Play(game);
+  const std::chrono::duration<double> duration =
+      std::chrono::steady_clock::now() - start_time;
+  result.seconds = duration.count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const int core_count =
+      std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+  int thread_count = core_count;
+  if ((argc != 2 && argc != 3) ||
+      (argc == 3 && !ParseArgument(argv[2], thread_count))) {
+    std::cerr << "Usage: replay_verifier <directory> [thread count]\n";
+    return EXIT_FAILURE;
+  }
+
+  std::error_code error;
+  std::vector<ReplayResult> results;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(argv[1], error)) {
+    if (entry.is_regular_file()) {
+      results.push_back({entry.path()});
+    }
+  }
+  if (error) {
+    std::cerr << "Could not read the directory " << argv[1] << '\n';
+    return EXIT_FAILURE;
+  }
+  std::sort(results.begin(), results.end(),
+            [](const ReplayResult& lhs, const ReplayResult& rhs) {
+              return lhs.path < rhs.path;
+            });
+
+  thread_count = std::clamp(thread_count, 1,
+                            std::max(static_cast<int>(results.size()), 1));
+
+  // The games own all their state, each thread plays the next replay that is
+  // not taken yet on its own game.
+  std::atomic<std::size_t> next_replay{0};
+  const auto start_time = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count);
+  for (int thread_index = 0; thread_index < thread_count; thread_index++) {
+    threads.emplace_back([&results, &next_replay] {
+      Game game;
+      for (auto index = next_replay++; index < results.size();
+           index = next_replay++) {
+        VerifyReplay(results[index], game);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  const std::chrono::duration<double> duration =
+      std::chrono::steady_clock::now() - start_time;
+
+  int failure_count = 0;
+  double total_frames = 0.0;
+  for (const auto& result : results) {
+    std::cout << result.path.filename().string() << ": ";
+    if (!result.is_loaded) {
+      std::cout << "not a replay\n";
+      failure_count++;
+      continue;
+    }
+
+    total_frames += result.frame_count;
+    const double frames_per_second =
+        result.seconds > 0.0 ? result.frame_count / result.seconds : 0.0;
+    std::cout << result.frame_count << " frames, " << frames_per_second
+              << " frames/s";
+    if (result.divergent_frame != -1) {
+      std::cout << ", checksum mismatch at frame " << result.divergent_frame;
+      failure_count++;
+    }
+    std::cout << '\n';
+  }
+
+  std::cout << results.size() << " replays on " << thread_count
+            << " threads in " << duration.count() << " s, "
+            << total_frames / duration.count() << " frames/s, "
+            << failure_count << " failed, peak memory " << GetPeakMemory()
+            << " KB\n";
+
+  return failure_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,103 @@
+// Saves the state of every frame of a recorded match in a SnapshotStore, as
+// the rollback would, and reports the compression ratio, the encode and decode
+// times, and the memory taken compared to uncompressed states. Every
+// second, the oldest kept frame is restored and simulated again up to the
+// current frame to check that the restored state is exact.
+//
+// Usage: snapshot_bench <replay> [keyframe interval]
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "Game.h"
+#include "arguments.h"
+#include "replay.h"
+#include "snapshot_store.h"
+
+namespace {
+
+void StartReplay(const Replay& replay, Game& game) {
+  game.Restart();
+  game.SetBallType(replay.ball_type);
+  game.SetPlayerCount(replay.player_count);
+  game.StartGame();
+  game.SetResimulating(true);
+}
+
+void SimulateFrame(const Replay& replay, int frame_nbr, Game& game) {
+  const auto& frame_inputs = replay.inputs[frame_nbr];
+  for (int player_id = 0; player_id < replay.player_count; player_id++) {
+    game.SetPlayerInput(player_id, frame_inputs[player_id]);
+  }
+  game.FixedUpdate();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int keyframe_interval = SnapshotStore::kDefaultKeyframeInterval;
+  if ((argc != 2 && argc != 3) ||
+      (argc == 3 && !ParseArgument(argv[2], keyframe_interval))) {
+    std::cerr << "Usage: snapshot_bench <replay> [keyframe interval]\n";
+    return EXIT_FAILURE;
+  }
+
+  Replay replay;
+  if (!replay.Load(argv[1])) {
+    std::cerr << "Could not read the replay " << argv[1] << '\n';
+    return EXIT_FAILURE;
+  }
+
+  SnapshotStore store(keyframe_interval);
+  Game game;
+  Game restored_game;
+  StartReplay(replay, game);
+  StartReplay(replay, restored_game);
+
+  StateWriter writer;
+  std::size_t state_size = 0;
+
+  for (int frame_nbr = 0; frame_nbr < replay.GetFrameCount(); frame_nbr++) {
+    SimulateFrame(replay, frame_nbr, game);
+    store.Save(frame_nbr, game);
+
+    if (frame_nbr % metrics::kFPS != metrics::kFPS - 1) {
+      continue;
+    }
+
+    const int oldest_frame =
+        std::max(frame_nbr - SnapshotStore::kCapacity + 1, 0);
+    if (!store.Load(oldest_frame, restored_game)) {
+      std::cout << "Could not restore frame " << oldest_frame << '\n';
+      return EXIT_FAILURE;
+    }
+    for (int resimulated_frame = oldest_frame + 1;
+         resimulated_frame <= frame_nbr; resimulated_frame++) {
+      SimulateFrame(replay, resimulated_frame, restored_game);
+    }
+    if (restored_game.CheckSum() != game.CheckSum()) {
+      std::cout << "The state restored from frame " << oldest_frame
+                << " differs at frame " << frame_nbr << '\n';
+      return EXIT_FAILURE;
+    }
+
+    writer.Clear();
+    game.Serialize(writer);
+    state_size = std::max(state_size, writer.GetSize());
+  }
+
+  const auto& stats = store.GetStats();
+  std::cout << replay.GetFrameCount() << " frames, keyframe every "
+            << store.GetKeyframeInterval() << " frames\n"
+            << "Compression ratio " << stats.GetCompressionRatio()
+            << ", encode " << stats.GetAverageEncodeMicroseconds()
+            << " us, decode " << stats.GetAverageDecodeMicroseconds()
+            << " us\n"
+            << "Memory " << store.GetMemorySize() << " bytes, "
+            << SnapshotStore::kCapacity << " uncompressed states "
+            << SnapshotStore::kCapacity * state_size << " bytes\n";
+
+  return EXIT_SUCCESS;
+}
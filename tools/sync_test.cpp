@@ -0,0 +1,167 @@
+// Plays a match offline while rolling back every frame, see SyncTest, and
+// reports the first frame that is not simulated the same way twice. The
+// inputs come from a replay, or from bots pressing random keys for random
+// durations. Also a benchmark of the worst case of the rollback. With
+// --island, every rollback also changes the input of a player and checks that
+// simulating only the bodies it can reach gives the whole world.
+//
+// Usage: sync_test [--island] <rollback depth> [player count [seed]]
+//        sync_test [--island] <rollback depth> --replay <replay>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "Game.h"
+#include "arguments.h"
+#include "replay.h"
+#include "sync_test.h"
+
+namespace {
+
+/**
+ * @brief Plays random inputs, each one held for a random number of frames so
+ * the players walk, jump and kick like real ones.
+ */
+class Bots {
+ public:
+  explicit Bots(unsigned int seed) : random_engine_(seed) {}
+
+  SyncTest::FrameInputs NextInputs(int player_count) {
+    std::uniform_int_distribution<int> input_distribution(
+        0, input::kJump | input::kLeft | input::kRight | input::kKick);
+    std::uniform_int_distribution<int> hold_distribution(kMinHoldFrames,
+                                                         kMaxHoldFrames);
+
+    for (int player_id = 0; player_id < player_count; player_id++) {
+      if (hold_frames_[player_id] <= 0) {
+        inputs_[player_id] =
+            static_cast<input::Input>(input_distribution(random_engine_));
+        hold_frames_[player_id] = hold_distribution(random_engine_);
+      }
+      hold_frames_[player_id]--;
+    }
+    return inputs_;
+  }
+
+ private:
+  static constexpr int kMinHoldFrames = 5;
+  static constexpr int kMaxHoldFrames = metrics::kFPS / 2;
+
+  std::mt19937 random_engine_;
+  SyncTest::FrameInputs inputs_{};
+  std::array<int, metrics::kMaxPlayerNbr> hold_frames_{};
+};
+
+void PrintUsage() {
+  std::cerr << "Usage: sync_test [--island] <rollback depth> [player count "
+               "[seed]]\n"
+               "       sync_test [--island] <rollback depth> --replay "
+               "<replay>\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  // The flag comes first, the other arguments keep their positions.
+  const bool is_island_mode = argc >= 2 && std::string(argv[1]) == "--island";
+  if (is_island_mode) {
+    argv++;
+    argc--;
+  }
+  if (argc < 2 || argc > 4) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+  int rollback_depth = 0;
+  if (!ParseArgument(argv[1], rollback_depth)) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+
+  Replay replay;
+  const bool is_replay = argc >= 3 && std::string(argv[2]) == "--replay";
+  if (is_replay) {
+    if (argc != 4) {
+      PrintUsage();
+      return EXIT_FAILURE;
+    }
+    if (!replay.Load(argv[3])) {
+      std::cerr << "Could not read the replay " << argv[3] << '\n';
+      return EXIT_FAILURE;
+    }
+  } else {
+    replay.player_count = metrics::kMinPlayerNbr;
+    if (argc >= 3 && !ParseArgument(argv[2], replay.player_count)) {
+      PrintUsage();
+      return EXIT_FAILURE;
+    }
+    replay.player_count = std::clamp(
+        replay.player_count, metrics::kMinPlayerNbr, metrics::kMaxPlayerNbr);
+  }
+  unsigned int seed = std::random_device{}();
+  if (!is_replay && argc == 4 && !ParseArgument(argv[3], seed)) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+  const int frame_count =
+      is_replay ? replay.GetFrameCount() : metrics::kGameFrameNbr;
+
+  SyncTest sync_test;
+  sync_test.Start(replay.player_count, replay.ball_type, rollback_depth,
+                  is_island_mode);
+
+  // Logs the rollback metrics of every second when a path is given.
+  if (const char* csv_path = std::getenv("ROLLBACK_TELEMETRY_CSV")) {
+    if (!sync_test.GetTelemetry().OpenCsv(csv_path)) {
+      std::cerr << "Could not open the telemetry file " << csv_path << '\n';
+    }
+  }
+
+  std::cout << replay.player_count << " players, " << frame_count
+            << " frames, rolled back " << sync_test.GetRollbackDepth()
+            << " frames every frame";
+  if (is_island_mode) {
+    std::cout << ", checking the island resimulation";
+  }
+  if (!is_replay) {
+    std::cout << ", bots with seed " << seed;
+  }
+  std::cout << '\n';
+
+  Bots bots(seed);
+  const auto start_time = std::chrono::steady_clock::now();
+
+  for (int frame_nbr = 0; frame_nbr < frame_count; frame_nbr++) {
+    const auto inputs = is_replay ? replay.inputs[frame_nbr]
+                                  : bots.NextInputs(replay.player_count);
+    if (!sync_test.AdvanceFrame(inputs)) {
+      std::cout << "The checksum of frame " << sync_test.GetDivergentFrame()
+                << " differs when it is simulated again at frame "
+                << frame_nbr << '\n';
+      return EXIT_FAILURE;
+    }
+  }
+
+  const std::chrono::duration<double> duration =
+      std::chrono::steady_clock::now() - start_time;
+  const double simulated_frames =
+      static_cast<double>(frame_count) * (sync_test.GetRollbackDepth() + 1);
+  std::cout << "Every checksum matches, " << frame_count << " frames in "
+            << duration.count() << " s, "
+            << duration.count() * 1000.0 / frame_count
+            << " ms per frame with its rollback, "
+            << simulated_frames / duration.count() << " simulated frames/s\n";
+  if (is_island_mode) {
+    std::cout << sync_test.GetIslandRollbackCount()
+              << " rollbacks simulated an island, "
+              << sync_test.GetWholeRollbackCount()
+              << " the whole world\n";
+  }
+
+  return EXIT_SUCCESS;
+}
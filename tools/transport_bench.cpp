@@ -0,0 +1,218 @@
+// Sends packets the size of an input packet between two peers over the
+// in-process loopback and, on Linux, over UDP sockets on localhost. Reports
+// the time taken by each packet and the datagrams sent and received by system
+// call, and checks that the reliable packets all arrive in order. The
+// loopback drops the unreliable packets at the given rate. The UDP sockets
+// drop the received datagrams at that rate in the lossy runs, whose reliable
+// packets must then be sent again, once with their numbers wrapping around.
+//
+// Usage: transport_bench [packet count] [loss rate]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "arguments.h"
+#include "loopback_transport.h"
+#ifdef __linux__
+#include "udp_transport.h"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// The size of an input packet with a few frames of inputs.
+constexpr std::size_t kPacketSize = 48;
+// The packets sent between two services, a frame of a busy session.
+constexpr int kPacketsPerService = 16;
+// Enough packets between two services to fill the buffer of a socket.
+constexpr int kBurstSize = 4096;
+// A lost packet holds the send window until it is sent again, the lossy runs
+// send fewer packets to end well before the timeout.
+constexpr int kLossyPacketCount = 2000;
+constexpr auto kTimeout = std::chrono::seconds(10);
+
+void WritePacketNbr(std::vector<std::uint8_t>& packet, int packet_nbr) {
+  for (int byte = 0; byte < 4; byte++) {
+    packet[byte] = static_cast<std::uint8_t>(packet_nbr >> (8 * byte));
+  }
+}
+
+int ReadPacketNbr(const std::vector<std::uint8_t>& packet) {
+  int packet_nbr = 0;
+  for (int byte = 0; byte < 4; byte++) {
+    packet_nbr |= packet[byte] << (8 * byte);
+  }
+  return packet_nbr;
+}
+
+struct BenchResult {
+  int received_count = 0;
+  // The packets of an unreliable transport may be lost but are not reordered
+  // by the loopback or on localhost.
+  bool is_in_order = true;
+  double microseconds_per_packet = 0;
+};
+
+/**
+ * @brief Sends the packets from the first transport to the second one and
+ * services both until they all arrived or the timeout.
+ */
+BenchResult Run(Transport& sender, Transport& receiver, int packet_count,
+                bool is_reliable,
+                int packets_per_service = kPacketsPerService) {
+  BenchResult result;
+  int last_packet_nbr = -1;
+  std::vector<std::uint8_t> packet(kPacketSize, 0);
+  TransportPacket received_packet;
+
+  const auto start = Clock::now();
+  int sent_count = 0;
+  while (result.received_count < packet_count &&
+         Clock::now() - start < kTimeout) {
+    for (int i = 0; i < packets_per_service && sent_count < packet_count;
+         i++) {
+      WritePacketNbr(packet, sent_count++);
+      if (is_reliable) {
+        sender.SendReliable(1, packet.data(), packet.size());
+      } else {
+        sender.SendUnreliable(1, packet.data(), packet.size());
+      }
+    }
+    sender.Service();
+    receiver.Service();
+
+    const auto receive = [&]() {
+      while (receiver.Receive(received_packet)) {
+        const int packet_nbr = ReadPacketNbr(received_packet.data);
+        if (packet_nbr <= last_packet_nbr) {
+          result.is_in_order = false;
+        }
+        last_packet_nbr = packet_nbr;
+        result.received_count++;
+      }
+    };
+    receive();
+
+    // The lost unreliable packets are not waited for.
+    if (!is_reliable && sent_count == packet_count) {
+      sender.Service();
+      receiver.Service();
+      receive();
+      break;
+    }
+  }
+
+  const std::chrono::duration<double, std::micro> duration =
+      Clock::now() - start;
+  result.microseconds_per_packet = duration.count() / packet_count;
+  return result;
+}
+
+void PrintResult(const std::string& name, const BenchResult& result,
+                 int packet_count) {
+  std::cout << name << ": " << result.received_count << '/' << packet_count
+            << " received" << (result.is_in_order ? "" : " out of order")
+            << ", " << result.microseconds_per_packet << " us per packet\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int packet_count = 100000;
+  float loss_rate = 0.1f;
+  if (argc > 3 || (argc >= 2 && !ParseArgument(argv[1], packet_count)) ||
+      (argc == 3 && !ParseArgument(argv[2], loss_rate))) {
+    std::cerr << "Usage: transport_bench [packet count] [loss rate]\n";
+    return EXIT_FAILURE;
+  }
+
+  bool is_valid = true;
+
+  const std::string loss = " with " + std::to_string(loss_rate) + " loss";
+
+  LoopbackNetwork loopback(2);
+  auto result = Run(loopback.GetTransport(0), loopback.GetTransport(1),
+                    packet_count, false);
+  PrintResult("Loopback unreliable", result, packet_count);
+  is_valid &= result.received_count == packet_count;
+
+  result = Run(loopback.GetTransport(0), loopback.GetTransport(1),
+               packet_count, true);
+  PrintResult("Loopback reliable", result, packet_count);
+  is_valid &= result.received_count == packet_count && result.is_in_order;
+
+  // The loopback only loses the unreliable packets.
+  loopback.SetLossRate(loss_rate);
+  result = Run(loopback.GetTransport(0), loopback.GetTransport(1),
+               packet_count, false);
+  PrintResult("Loopback unreliable" + loss, result, packet_count);
+
+#ifdef __linux__
+  struct UdpRun {
+    std::string name;
+    bool is_reliable;
+    int packets_per_service;
+    bool is_lossy;
+    std::uint32_t first_sequence;
+  };
+  // Half of the packets are numbered before the wraparound.
+  const int lossy_packet_count = std::min(packet_count, kLossyPacketCount);
+  const auto wraparound_sequence =
+      static_cast<std::uint32_t>(-(lossy_packet_count / 2));
+  for (const auto& run :
+       {UdpRun{"Udp unreliable", false, kPacketsPerService, false, 0},
+        UdpRun{"Udp reliable", true, kPacketsPerService, false, 0},
+        UdpRun{"Udp reliable bursts", true, kBurstSize, false, 0},
+        UdpRun{"Udp reliable" + loss, true, kPacketsPerService, true, 0},
+        UdpRun{"Udp reliable" + loss + " across the sequence wraparound",
+               true, kPacketsPerService, true, wraparound_sequence}}) {
+    UdpTransport sender;
+    UdpTransport receiver;
+    if (!sender.Open(0) || !receiver.Open(0) ||
+        !sender.SetPeer(1, "127.0.0.1", receiver.GetLocalPort(),
+                        run.first_sequence) ||
+        !receiver.SetPeer(0, "127.0.0.1", sender.GetLocalPort(),
+                          run.first_sequence)) {
+      std::cerr << "Could not open the udp sockets\n";
+      return EXIT_FAILURE;
+    }
+    if (run.is_lossy) {
+      // The acknowledgments are lost too.
+      sender.SetLossRate(loss_rate);
+      receiver.SetLossRate(loss_rate);
+    }
+
+    const int run_packet_count =
+        run.is_lossy ? lossy_packet_count : packet_count;
+    result = Run(sender, receiver, run_packet_count, run.is_reliable,
+                 run.packets_per_service);
+    PrintResult(run.name, result, run_packet_count);
+    if (run.is_reliable) {
+      is_valid &=
+          result.received_count == run_packet_count && result.is_in_order;
+    }
+
+    const auto& sender_stats = sender.GetStats();
+    const auto& receiver_stats = receiver.GetStats();
+    std::cout << "  " << sender_stats.sent_datagrams << " datagrams sent in "
+              << sender_stats.send_calls << " calls, "
+              << receiver_stats.received_datagrams << " received in "
+              << receiver_stats.receive_calls << " calls, "
+              << receiver_stats.lost_datagrams << " lost, "
+              << sender_stats.resent_packets << " resent\n";
+    // Without resends, the lost packets could not have all arrived.
+    if (run.is_lossy && loss_rate > 0.f) {
+      is_valid &= receiver_stats.lost_datagrams > 0 &&
+                  sender_stats.resent_packets > 0;
+    }
+  }
+#endif
+
+  return is_valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}